@@ -0,0 +1,322 @@
+/*
+ * Concurrent PUT /state, POST /batch and GET /state requests against main/device_batch.c,
+ * parsed with main/json_reader.c and serialized by the shared mutex, from several threads at
+ * once. The device has 8 outputs: PUT switches output 0, batches switch outputs 1 to 7 to one
+ * state and GET reads them all back. Checks that set_output calls never overlap, that every
+ * GET sees outputs 1 to 7 equal (a batch is applied all or nothing), that rejected batches
+ * apply nothing and that set_output ran exactly once per accepted operation. Run it with
+ * -fsanitize=thread to also have the accesses checked.
+ */
+#include "device_batch.h"
+#include "json_reader.h"
+#include "web_server.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_REQUESTS 20000  // Per thread
+#define THREADS_PER_KIND 4
+#define NUM_OUTPUTS 8
+#define BATCH_OUTPUTS (NUM_OUTPUTS - 1)
+#define BODY_SIZE JSON_READER_MAX_BODY
+#define RESPONSE_SIZE 512       // resp_buf of web_server.c
+
+enum { ENDPOINT_GET_STATE, ENDPOINT_PUT_STATE, ENDPOINT_BATCH };
+
+typedef struct {
+    int kind;
+    long requests;
+    uint64_t rng;
+    unsigned long applied;      // set_output calls this thread's accepted requests asked for
+    unsigned long rejected;
+} worker_t;
+
+SemaphoreHandle_t mutex;
+
+static int outputs[NUM_OUTPUTS];        // Only accessed with mutex held
+static unsigned long set_output_calls;  // Only accessed with mutex held
+static int in_set_output;
+static int failures;
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fail(const char *what, const char *reply) {
+    // Only the first few are printed, the count is reported at the end
+    if (__atomic_fetch_add(&failures, 1, __ATOMIC_RELAXED) < 10) {
+        printf("FAIL %s: %s\n", what, reply != NULL ? reply : "");
+    }
+}
+
+static uint32_t rng(worker_t *worker) {
+    worker->rng ^= worker->rng << 13;
+    worker->rng ^= worker->rng >> 7;
+    worker->rng ^= worker->rng << 17;
+    return (uint32_t)(worker->rng >> 32);
+}
+
+static void stress_set_output(int output, int state) {
+    if (__atomic_exchange_n(&in_set_output, 1, __ATOMIC_ACQUIRE)) {
+        fail("set_output called concurrently", NULL);
+    }
+    outputs[output] = state;
+    set_output_calls++;
+    sched_yield();              // Switching a relay takes a while, widen the window for races
+    __atomic_store_n(&in_set_output, 0, __ATOMIC_RELEASE);
+}
+
+static int stress_get_output(int output) {
+    return outputs[output];
+}
+
+// As handle_put_state of smart_plug_actions.c
+static esp_err_t handle_put_state(const action_request_t *request, json_writer_t *response) {
+    int32_t state;
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = &state, .min = 0, .max = 1, .required = true },
+    };
+
+    if (request->body == NULL ||
+        json_parse_object(request->body, request->body_len, fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    stress_set_output(0, state);
+    xSemaphoreGive(mutex);
+
+    json_obj_begin(response, NULL);
+    json_int(response, "state", state);
+    json_obj_end(response);
+    return ESP_OK;
+}
+
+static esp_err_t handle_get_state(const action_request_t *request, json_writer_t *response) {
+    int states[NUM_OUTPUTS];
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    memcpy(states, outputs, sizeof(states));
+    xSemaphoreGive(mutex);
+
+    json_arr_begin(response, NULL);
+    for (int i = 0; i < NUM_OUTPUTS; i++) {
+        json_obj_begin(response, NULL);
+        json_int(response, "output", i);
+        json_int(response, "state", states[i]);
+        json_obj_end(response);
+    }
+    json_arr_end(response);
+    return ESP_OK;
+}
+
+static const device_endpoint_t stress_endpoints[] = {
+    [ENDPOINT_GET_STATE] = { .uri = "/state", .method = ACTION_GET, .handler = handle_get_state },
+    [ENDPOINT_PUT_STATE] = { .uri = "/state", .method = ACTION_PUT, .handler = handle_put_state },
+    [ENDPOINT_BATCH] = { .uri = "/batch", .method = ACTION_POST, .handler = device_batch_handler },
+};
+
+const device_config_t DEVICE_CONFIG = {
+    .device_type = "stress",
+    .endpoints = stress_endpoints,
+    .num_endpoints = sizeof(stress_endpoints) / sizeof(stress_endpoints[0]),
+    .num_outputs = NUM_OUTPUTS,
+    .get_output = stress_get_output,
+    .set_output = stress_set_output,
+};
+
+// Runs an endpoint the way the server does, the reply is NUL terminated in response
+static esp_err_t request(int endpoint, const char *body, char *response) {
+    const action_request_t req = {
+        .body = body,
+        .body_len = body != NULL ? strlen(body) : 0,
+        .format = ACTION_FORMAT_JSON,
+    };
+    json_writer_t w;
+
+    json_writer_init(&w, response, RESPONSE_SIZE - 1, NULL, NULL);
+    esp_err_t err = stress_endpoints[endpoint].handler(&req, &w);
+    if (err == ESP_OK) {
+        err = json_writer_status(&w);
+    }
+    response[err == ESP_OK ? w.len : 0] = '\0';
+    return err;
+}
+
+typedef struct {
+    int32_t states[NUM_OUTPUTS];
+    uint32_t seen;              // Bit per output
+} reply_t;
+
+static esp_err_t parse_result(void *ctx, size_t index, const char *buf, size_t len) {
+    reply_t *reply = (reply_t *)ctx;
+    int32_t output;
+    int32_t state;
+    const json_field_t fields[] = {
+        { .key = "output", .type = JSON_FIELD_INT, .value = &output, .min = 0, .max = NUM_OUTPUTS - 1, .required = true },
+        { .key = "state", .type = JSON_FIELD_INT, .value = &state, .min = 0, .max = 1, .required = true },
+    };
+
+    if (json_parse_object(buf, len, fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    reply->states[output] = state;
+    reply->seen |= 1u << output;
+    return ESP_OK;
+}
+
+// The array of a reply, on its own for GET or the "results" member of a batch reply
+static esp_err_t parse_reply(const char *response, reply_t *reply) {
+    const char *start = strchr(response, '[');
+    const char *end = strrchr(response, ']');
+
+    memset(reply, 0, sizeof(*reply));
+    if (start == NULL || end == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return json_parse_array(start, end + 1 - start, parse_result, reply);
+}
+
+static void put_request(worker_t *worker, char *response) {
+    char body[BODY_SIZE];
+    int32_t state = rng(worker) & 1;
+    int32_t got = -1;
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = &got, .min = 0, .max = 1, .required = true },
+    };
+
+    snprintf(body, sizeof(body), "{\"state\": %d}", (int)state);
+    if (request(ENDPOINT_PUT_STATE, body, response) != ESP_OK ||
+        json_parse_object(response, strlen(response), fields, 1, NULL) != ESP_OK || got != state) {
+        fail("PUT /state reply", response);
+        return;
+    }
+    worker->applied++;
+}
+
+// Every fourth batch has a bad last operation, so none of its operations may be applied
+static void batch_request(worker_t *worker, char *response) {
+    char body[BODY_SIZE];
+    int32_t state = rng(worker) & 1;
+    bool bad = rng(worker) % 4 == 0;
+    size_t len = snprintf(body, sizeof(body), "[");
+    reply_t reply;
+
+    for (int i = 1; i <= BATCH_OUTPUTS; i++) {
+        int op_state = bad && i == BATCH_OUTPUTS ? 2 : (int)state;
+        len += snprintf(body + len, sizeof(body) - len, "%s{\"output\":%d,\"state\":%d}",
+                        i > 1 ? "," : "", i, op_state);
+    }
+    snprintf(body + len, sizeof(body) - len, "]");
+
+    esp_err_t err = request(ENDPOINT_BATCH, body, response);
+    if (bad) {
+        if (err != ESP_ERR_INVALID_ARG) {
+            fail("bad batch accepted", response);
+        }
+        worker->rejected++;
+        return;
+    }
+    if (err != ESP_OK || parse_reply(response, &reply) != ESP_OK ||
+        reply.seen != ((1u << NUM_OUTPUTS) - 2)) {
+        fail("POST /batch reply", response);
+        return;
+    }
+    for (int i = 1; i <= BATCH_OUTPUTS; i++) {
+        if (reply.states[i] != state) {
+            fail("POST /batch result", response);
+            break;
+        }
+    }
+    worker->applied += BATCH_OUTPUTS;
+}
+
+static void get_request(worker_t *worker, char *response) {
+    reply_t reply;
+
+    if (request(ENDPOINT_GET_STATE, NULL, response) != ESP_OK || parse_reply(response, &reply) != ESP_OK ||
+        reply.seen != (1u << NUM_OUTPUTS) - 1) {
+        fail("GET /state reply", response);
+        return;
+    }
+    for (int i = 2; i <= BATCH_OUTPUTS; i++) {
+        if (reply.states[i] != reply.states[1]) {
+            fail("GET /state saw part of a batch", response);
+            break;
+        }
+    }
+}
+
+static void *worker_task(void *arg) {
+    worker_t *worker = (worker_t *)arg;
+    char response[RESPONSE_SIZE];
+
+    for (long n = 0; n < worker->requests; n++) {
+        switch (worker->kind) {
+        case ENDPOINT_PUT_STATE:
+            put_request(worker, response);
+            break;
+        case ENDPOINT_BATCH:
+            batch_request(worker, response);
+            break;
+        default:
+            get_request(worker, response);
+            break;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    long requests = argc > 1 ? atol(argv[1]) : DEFAULT_REQUESTS;
+    int threads = argc > 2 ? atoi(argv[2]) : THREADS_PER_KIND;
+    static const char *kinds[] = {"GET /state", "PUT /state", "POST /batch"};
+
+    if (requests <= 0 || threads <= 0) {
+        fprintf(stderr, "usage: %s [requests per thread] [threads per request kind]\n", argv[0]);
+        return 1;
+    }
+    mutex = xSemaphoreCreateMutex();
+
+    int count = 3 * threads;
+    worker_t *workers = calloc(count, sizeof(worker_t));
+    pthread_t *ids = calloc(count, sizeof(pthread_t));
+    double start = now_secs();
+    for (int i = 0; i < count; i++) {
+        workers[i] = (worker_t){
+            .kind = i % 3,
+            .requests = requests,
+            .rng = 0x9e3779b97f4a7c15ULL * (i + 1),
+        };
+        pthread_create(&ids[i], NULL, worker_task, &workers[i]);
+    }
+    unsigned long applied = 0;
+    unsigned long rejected = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_join(ids[i], NULL);
+        applied += workers[i].applied;
+        rejected += workers[i].rejected;
+    }
+    double secs = now_secs() - start;
+
+    for (int i = 0; i < 3; i++) {
+        printf("%-11s: %d threads, %ld requests each\n", kinds[i], threads, requests);
+    }
+    printf("%.0f requests per second, %lu rejected batches\n", count * requests / secs, rejected);
+    if (set_output_calls != applied) {
+        printf("FAIL set_output ran %lu times for %lu accepted operations\n", set_output_calls, applied);
+        failures++;
+    }
+    free(workers);
+    free(ids);
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
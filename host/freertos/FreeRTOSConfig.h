@@ -0,0 +1,53 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+// Kernel configuration of the host build with -DUSE_FREERTOS=1 against the FreeRTOS POSIX
+// simulator (portable/ThirdParty/GCC/Posix), see host/freertos_sim.sh. Each task is a
+// pthread running on the task stack, so stacks are sized for CoreMark rather than a
+// microcontroller.
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_TIME_SLICING                  1
+#define configTICK_RATE_HZ                      1000
+#define configMAX_PRIORITIES                    8
+#define configMINIMAL_STACK_SIZE                ((unsigned short)4096)  // Words, above PTHREAD_STACK_MIN
+#define configMAX_TASK_NAME_LEN                 16
+#define configTICK_TYPE_WIDTH_IN_BITS           TICK_TYPE_WIDTH_32_BITS
+#define configUSE_16_BIT_TICKS                  0   // Kernels before V11
+#define configIDLE_SHOULD_YIELD                 1
+
+#define configSUPPORT_DYNAMIC_ALLOCATION        1
+#define configSUPPORT_STATIC_ALLOCATION         0
+#define configTOTAL_HEAP_SIZE                   ((size_t)(1024 * 1024)) // Unused with heap_3
+
+#define configUSE_IDLE_HOOK                     0
+#define configUSE_TICK_HOOK                     0
+#define configUSE_MALLOC_FAILED_HOOK            0
+#define configCHECK_FOR_STACK_OVERFLOW          0
+
+#define configUSE_MUTEXES                       1
+#define configUSE_RECURSIVE_MUTEXES             0
+#define configUSE_COUNTING_SEMAPHORES           0
+#define configQUEUE_REGISTRY_SIZE               0
+#define configUSE_TASK_NOTIFICATIONS            1
+#define configUSE_EVENT_GROUPS                  1   // Start and done bits of the contexts
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH                8
+#define configTIMER_TASK_STACK_DEPTH            configMINIMAL_STACK_SIZE
+#define configUSE_TRACE_FACILITY                0
+#define configGENERATE_RUN_TIME_STATS           0
+#define configUSE_CO_ROUTINES                   0
+
+#define INCLUDE_vTaskDelete                     1
+#define INCLUDE_vTaskDelay                      1
+#define INCLUDE_vTaskSuspend                    1
+#define INCLUDE_uxTaskPriorityGet               1
+#define INCLUDE_xTaskGetSchedulerState          1
+#define INCLUDE_xTaskGetCurrentTaskHandle       1
+
+#define configASSERT(x) do { if (!(x)) { vAssertCalled(__FILE__, __LINE__); } } while (0)
+void vAssertCalled(const char *file, unsigned long line);
+
+#endif // FREERTOS_CONFIG_H
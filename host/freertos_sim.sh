@@ -0,0 +1,30 @@
+#!/bin/bash
+# Build and run the host benchmark with the FreeRTOS task-per-context implementation of
+# the device, against the FreeRTOS POSIX simulator.
+# Usage: host/freertos_sim.sh [contexts] [gcc flags...]   e.g. host/freertos_sim.sh 2 -O3
+# FREERTOS_KERNEL points to a FreeRTOS-Kernel checkout (V10.5 or later), a pinned one is
+# cloned to host/FreeRTOS-Kernel when it is not set.
+
+set -e
+cd "$(dirname "$0")/.."
+
+CONTEXTS=${1:-2}
+shift || true
+FLAGS=("$@")
+if [ ${#FLAGS[@]} -eq 0 ]; then
+    FLAGS=(-O3)
+fi
+KERNEL=${FREERTOS_KERNEL:-host/FreeRTOS-Kernel}
+if [ ! -d "$KERNEL" ]; then
+    git clone --depth 1 --branch V11.1.0 https://github.com/FreeRTOS/FreeRTOS-Kernel.git "$KERNEL"
+fi
+PORT=$KERNEL/portable/ThirdParty/GCC/Posix
+
+gcc "${FLAGS[@]}" -Imain -Ihost/freertos -I"$KERNEL/include" -I"$PORT" -I"$PORT/utils" \
+    -DPERFORMANCE_RUN=1 -DMULTITHREAD="$CONTEXTS" -DUSE_FREERTOS=1 -DCOMPILER_FLAGS="\"${FLAGS[*]}\"" \
+    main/core_list_join.c main/core_main.c main/core_matrix.c main/core_state.c \
+    main/core_util.c main/core_portme.c \
+    "$KERNEL/tasks.c" "$KERNEL/list.c" "$KERNEL/queue.c" "$KERNEL/event_groups.c" "$KERNEL/timers.c" \
+    "$PORT/port.c" "$PORT/utils/wait_for_event.c" "$KERNEL/portable/MemMang/heap_3.c" \
+    -lpthread -o coremark_freertos
+./coremark_freertos -c"$CONTEXTS"
@@ -0,0 +1,282 @@
+/*
+ * Pulse train injector for main/hlw8012.c. The driver is built against the host/idf
+ * stand-ins with HLW8012_TEST_HOOKS; this file provides its GPIO and timer calls on a virtual clock, feeds
+ * CF and CF1 pulses of known periods through its pin handlers, fires the gate timer and
+ * checks the readings: W, V and A against the periods, energy_uws against the pulse count,
+ * the SEL alternation, pulse rings overwritten within a window and a re-read of a ring
+ * pushed to while it is drained.
+ */
+#include "hlw8012.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SEL_PIN 12
+#define CF_PIN 5
+#define CF1_PIN 14
+#define MAX_PINS 32
+#define GATE_MS 1000
+#define GATE_US (GATE_MS * 1000)
+#define RING_SIZE 32            // PULSE_RING_SIZE
+#define POWER_MULTIPLIER 2.0f   // W per Hz, so a CF pulse is 2 Ws
+#define CURRENT_MULTIPLIER 0.01f
+#define VOLTAGE_MULTIPLIER 0.5f
+#define TOLERANCE 0.001f
+
+static uint64_t now_us;
+static gpio_isr_t handlers[MAX_PINS];
+static void *handler_args[MAX_PINS];
+static int levels[MAX_PINS];
+static int sel_switches;
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t period_us;
+    uint64_t next_us;
+};
+static struct esp_timer gate;
+
+// Pulse trains, a period of 0 stops the output
+static uint32_t cf_period;
+static uint32_t cf1_periods[2];         // SEL low (current), SEL high (voltage)
+static uint64_t cf_next;
+static uint64_t cf1_next;
+static uint64_t cf_pulses;
+
+// Pulses pushed by the drain hook, rings in the order the gate drains them: CF then CF1
+static const void *rings[2];
+static int ring_reads[2];
+static int cf_pushes;
+static int cf1_pushes;
+
+static int failures;
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer) {
+    gate.callback = args->callback;
+    gate.arg = args->arg;
+    *timer = &gate;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    timer->period_us = period_us;
+    timer->next_us = now_us + period_us;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    timer->period_us = 0;
+    return ESP_OK;
+}
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level) {
+    if (pin == SEL_PIN && levels[pin] != (int)level) {
+        sel_switches++;
+    }
+    levels[pin] = level;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t handler, void *arg) {
+    handlers[pin] = handler;
+    handler_args[pin] = arg;
+    return ESP_OK;
+}
+
+static void pulse(int pin, uint64_t when) {
+    now_us = when;
+    handlers[pin](handler_args[pin]);
+}
+
+static void cf_pulse(uint64_t when) {
+    pulse(CF_PIN, when);
+    cf_pulses++;
+    cf_next = when + cf_period;
+}
+
+// A CF train continues while its ring is read. A CF1 pulse arrives after its ring was read,
+// before SEL is switched, so it belongs to the quantity of the closing window.
+void hlw8012_drain_hook(const void *ring) {
+    int r = rings[0] == NULL || rings[0] == ring ? 0 : 1;
+
+    rings[r] = ring;
+    ring_reads[r]++;
+    for (; r == 0 && cf_pushes > 0; cf_pushes--) {
+        cf_pulse(cf_next);
+    }
+    for (; r == 1 && cf1_pushes > 0; cf1_pushes--) {
+        pulse(CF1_PIN, now_us);
+    }
+}
+
+// Run the pulse trains and the gate timer for a number of gates
+static void run_gates(int gates) {
+    while (gates > 0) {
+        uint64_t next = gate.next_us;
+        if (cf_period > 0 && cf_next < next) {
+            next = cf_next;
+        }
+        if (cf1_periods[levels[SEL_PIN]] > 0 && cf1_next < next) {
+            next = cf1_next;
+        }
+        if (next == gate.next_us) {
+            now_us = next;
+            gate.next_us += gate.period_us;
+            gate.callback(gate.arg);
+            // The other quantity comes out of CF1 from the switch on
+            cf1_next = now_us + cf1_periods[levels[SEL_PIN]] / 3;
+            gates--;
+        } else if (next == cf_next) {
+            cf_pulse(next);
+        } else {
+            pulse(CF1_PIN, next);
+            cf1_next = next + cf1_periods[levels[SEL_PIN]];
+        }
+    }
+}
+
+// The first pulses are a third of a period in, so trains are not in phase with the gate
+static void set_trains(uint32_t cf, uint32_t current, uint32_t voltage) {
+    cf_period = cf;
+    cf_next = now_us + cf / 3;
+    cf1_periods[0] = current;
+    cf1_periods[1] = voltage;
+    cf1_next = now_us + cf1_periods[levels[SEL_PIN]] / 3;
+}
+
+static void check(bool ok, const char *test, const char *what, double got, double expected) {
+    if (!ok) {
+        printf("FAIL %s: %s is %.6g, expected %.6g\n", test, what, got, expected);
+        failures++;
+    }
+}
+
+static void check_near(const char *test, const char *what, float got, float expected) {
+    check(fabsf(got - expected) <= fabsf(expected) * TOLERANCE + 1e-6f, test, what, got, expected);
+}
+
+static void check_readings(const char *test, float watts, float amps, float volts) {
+    hlw8012_readings_t r;
+
+    hlw8012_get_readings(&r);
+    check_near(test, "power", r.power, watts);
+    check_near(test, "current", r.current, amps);
+    check_near(test, "voltage", r.voltage, volts);
+    check(r.energy_uws == cf_pulses * (uint64_t)(POWER_MULTIPLIER * 1000000), test, "energy_uws",
+          (double)r.energy_uws, (double)(cf_pulses * (uint64_t)(POWER_MULTIPLIER * 1000000)));
+}
+
+// 100 W, 0.4 A and 250 V: trains of 20 ms, 25 ms and 2 ms
+static void test_steady(void) {
+    int switches = sel_switches;
+
+    set_trains(20000, 25000, 2000);
+    run_gates(4);
+    check_readings("steady", 100, 0.4f, 250);
+    check(sel_switches - switches == 4 && levels[SEL_PIN] == 0, "steady", "SEL switches",
+          sel_switches - switches, 4);
+}
+
+// 2 kW is 2000 CF pulses per window, the ring wraps 62 times between two drains
+static void test_overwrite(void) {
+    set_trains(1000, 5000, 2000);
+    run_gates(4);
+    check_readings("overwrite", 2000, 2, 250);
+}
+
+// 40 more pulses land in the CF ring while the gate reads it, overwriting the stamps being
+// read, so the drain must read it again
+static void test_reread(void) {
+    set_trains(1000, 5000, 2000);
+    run_gates(2);
+    ring_reads[0] = 0;
+    cf_pushes = RING_SIZE + 8;
+    run_gates(1);
+    check(ring_reads[0] >= 2, "reread", "CF ring reads", ring_reads[0], 2);
+    check_readings("reread", 2000, 2, 250);
+    run_gates(1);
+    check_readings("reread", 2000, 2, 250);
+}
+
+// A CF1 pulse between the drain and the SEL switch is left out of the next window. CF1 runs
+// at 10 Hz for 0.1 A and 5 V, so the windows are read from their first pulse.
+static void test_sel_switch(void) {
+    set_trains(20000, 100000, 100000);
+    run_gates(2);
+    cf1_pushes = 1;
+    run_gates(2);
+    check_readings("sel_switch", 100, 0.1f, 5);
+    // Then in the other phase
+    run_gates(1);
+    cf1_pushes = 1;
+    run_gates(2);
+    check_readings("sel_switch", 100, 0.1f, 5);
+}
+
+// 1 W is one CF pulse every other window, measured across windows
+static void test_slow(void) {
+    set_trains(2000000, 25000, 2000);
+    run_gates(5);
+    check_readings("slow", 1, 0.4f, 250);
+}
+
+// Without pulses the power reads zero after HLW8012_PULSE_TIMEOUT_MS
+static void test_timeout(void) {
+    set_trains(0, 25000, 2000);
+    run_gates(HLW8012_PULSE_TIMEOUT_MS / GATE_MS + 2);
+    check_readings("timeout", 0, 0.4f, 250);
+}
+
+// A persisted count is continued
+static void test_set_energy(void) {
+    hlw8012_set_energy(123 * (uint64_t)(POWER_MULTIPLIER * 1000000));
+    cf_pulses = 123;
+    set_trains(20000, 25000, 2000);
+    run_gates(2);
+    check_readings("set_energy", 100, 0.4f, 250);
+}
+
+int main(void) {
+    const hlw8012_config_t config = {
+        .sel_pin = SEL_PIN,
+        .cf_pin = CF_PIN,
+        .cf1_pin = CF1_PIN,
+        .current_multiplier = CURRENT_MULTIPLIER,
+        .voltage_multiplier = VOLTAGE_MULTIPLIER,
+        .power_multiplier = POWER_MULTIPLIER,
+        .gate_ms = GATE_MS,
+    };
+
+    now_us = 1000;
+    if (hlw8012_init(&config) != ESP_OK) {
+        printf("FAIL init\n");
+        return 1;
+    }
+    test_steady();
+    test_overwrite();
+    test_reread();
+    test_sel_switch();
+    test_slow();
+    test_timeout();
+    test_set_energy();
+    if (failures > 0) {
+        printf("%d checks failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef HOST_ESP_CLK_H
+#define HOST_ESP_CLK_H
+
+// 0 on a host, the clock is not known
+int esp_clk_cpu_freq(void);
+
+#endif // HOST_ESP_CLK_H
@@ -0,0 +1,173 @@
+#include "esp_http_client.h"
+#include <netdb.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HTTP_MAX_HOST 64
+#define HTTP_MAX_PATH 128
+#define HTTP_MAX_HEADERS 256
+#define HTTP_MAX_RESPONSE 2048
+
+struct esp_http_client {
+    char host[HTTP_MAX_HOST];
+    char port[8];
+    char path[HTTP_MAX_PATH];
+    int timeout_ms;
+    esp_http_client_method_t method;
+    char headers[HTTP_MAX_HEADERS];
+    size_t headers_len;
+    const char *post_data;
+    int post_len;
+    int status;
+};
+
+static const char *method_names[] = {
+    [HTTP_METHOD_GET] = "GET",
+    [HTTP_METHOD_POST] = "POST",
+    [HTTP_METHOD_PUT] = "PUT",
+};
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    const char *url = config->url;
+    const char *scheme = "http://";
+
+    if (url == NULL || strncmp(url, scheme, strlen(scheme)) != 0) {
+        return NULL;
+    }
+    url += strlen(scheme);
+    size_t host_len = strcspn(url, ":/");
+    if (host_len == 0 || host_len >= HTTP_MAX_HOST) {
+        return NULL;
+    }
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+    if (client == NULL) {
+        return NULL;
+    }
+    memcpy(client->host, url, host_len);
+    url += host_len;
+    strcpy(client->port, "80");
+    if (*url == ':') {
+        size_t port_len = strcspn(++url, "/");
+        if (port_len == 0 || port_len >= sizeof(client->port)) {
+            free(client);
+            return NULL;
+        }
+        memcpy(client->port, url, port_len);
+        client->port[port_len] = '\0';
+        url += port_len;
+    }
+    snprintf(client->path, sizeof(client->path), "%s", *url ? url : "/");
+    client->method = config->method;
+    client->timeout_ms = config->timeout_ms > 0 ? config->timeout_ms : 5000;
+    return client;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+    int len = snprintf(client->headers + client->headers_len, sizeof(client->headers) - client->headers_len,
+                       "%s: %s\r\n", key, value);
+    if (len < 0 || (size_t)len >= sizeof(client->headers) - client->headers_len) {
+        client->headers[client->headers_len] = '\0';
+        return ESP_ERR_NO_MEM;
+    }
+    client->headers_len += len;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len) {
+    client->post_data = data;
+    client->post_len = data != NULL ? len : 0;
+    return ESP_OK;
+}
+
+static int http_connect(esp_http_client_handle_t client) {
+    struct addrinfo hints = {.ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM};
+    struct addrinfo *addrs;
+    struct timeval timeout = {
+        .tv_sec = client->timeout_ms / 1000,
+        .tv_usec = (client->timeout_ms % 1000) * 1000,
+    };
+    int fd = -1;
+
+    if (getaddrinfo(client->host, client->port, &hints, &addrs) != 0) {
+        return -1;
+    }
+    for (struct addrinfo *a = addrs; a != NULL && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        if (connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addrs);
+    return fd;
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t client) {
+    char request[HTTP_MAX_PATH + HTTP_MAX_HOST + HTTP_MAX_HEADERS + 128];
+    char response[HTTP_MAX_RESPONSE];
+    char drain[HTTP_MAX_RESPONSE];
+    size_t received = 0;
+    ssize_t len = 0;
+
+    client->status = 0;
+    int fd = http_connect(client);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    int header_len = snprintf(request, sizeof(request),
+                              "%s %s HTTP/1.1\r\nHost: %s\r\nContent-Length: %d\r\n%sConnection: close\r\n\r\n",
+                              method_names[client->method], client->path, client->host, client->post_len,
+                              client->headers);
+    bool sent = send_all(fd, request, header_len) &&
+                send_all(fd, client->post_data != NULL ? client->post_data : "", client->post_len);
+    // The status line is in the first bytes, the rest of the reply is read to the end
+    while (sent && received < sizeof(response) - 1 &&
+           (len = recv(fd, response + received, sizeof(response) - 1 - received, 0)) > 0) {
+        received += len;
+    }
+    while (sent && received == sizeof(response) - 1 && recv(fd, drain, sizeof(drain), 0) > 0) {
+    }
+    close(fd);
+    response[received] = '\0';
+    if (!sent || sscanf(response, "HTTP/1.%*d %d", &client->status) != 1) {
+        client->status = 0;
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    return client->status;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    free(client);
+    return ESP_OK;
+}
@@ -0,0 +1,641 @@
+#include "esp_http_server.h"
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define HTTPD_MAX_HEADERS 1024      // Request line and headers
+#define HTTPD_MAX_RESP_HEADERS 8
+#define HTTPD_MAX_WORK 16
+
+// A connection, kept across the requests of a keep-alive client
+typedef struct {
+    int fd;                         // -1 when the slot is free
+    char in[HTTPD_MAX_HEADERS];     // Received and not yet consumed
+    size_t in_len;
+    uint64_t last_used;             // Order of use for the LRU purge
+    bool close;                     // Close once the current request is done
+    void *ctx;
+    httpd_free_ctx_fn_t free_ctx;
+} httpd_session_t;
+
+typedef struct {
+    httpd_work_fn_t fn;
+    void *arg;
+} httpd_work_t;
+
+typedef struct {
+    httpd_config_t config;
+    int listener;
+    int wake[2];                    // Pipe waking the server thread for work and stop
+    pthread_t thread;
+    httpd_uri_t *handlers;
+    int handler_count;
+    httpd_session_t *sessions;
+    uint64_t uses;
+    pthread_mutex_t lock;           // Guards work, work_count and stop
+    httpd_work_t work[HTTPD_MAX_WORK];
+    int work_count;
+    bool stop;
+} httpd_server_t;
+
+// Request in progress on a session
+typedef struct {
+    httpd_session_t *session;
+    const char *headers;            // After the request line, NUL terminated
+    const char *query;              // After '?', NULL without one
+    size_t body_left;               // Body bytes not read by the handler yet
+    const char *status;
+    const char *type;
+    const char *resp_fields[HTTPD_MAX_RESP_HEADERS];
+    const char *resp_values[HTTPD_MAX_RESP_HEADERS];
+    int resp_count;
+    bool sent_headers;
+    bool chunked;
+    bool failed;                    // The connection broke while replying
+} httpd_req_aux_t;
+
+static const char *method_names[] = {
+    [HTTP_DELETE] = "DELETE",
+    [HTTP_GET] = "GET",
+    [HTTP_HEAD] = "HEAD",
+    [HTTP_POST] = "POST",
+    [HTTP_PUT] = "PUT",
+};
+
+static void session_close(httpd_session_t *session) {
+    if (session->fd < 0) {
+        return;
+    }
+    if (session->free_ctx != NULL && session->ctx != NULL) {
+        session->free_ctx(session->ctx);
+    }
+    close(session->fd);
+    session->fd = -1;
+    session->ctx = NULL;
+    session->free_ctx = NULL;
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t sent = send(fd, data, len, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return true;
+}
+
+bool httpd_uri_match_wildcard(const char *reference_uri, const char *uri_to_match, size_t match_upto) {
+    size_t len = strlen(reference_uri);
+    bool wildcard = len > 0 && reference_uri[len - 1] == '*';
+    bool optional = false;
+
+    if (wildcard) {
+        len--;
+        optional = len > 0 && reference_uri[len - 1] == '?';
+        if (optional) {
+            len--;
+        }
+    }
+    if (match_upto >= len && strncmp(reference_uri, uri_to_match, len) == 0) {
+        return wildcard || match_upto == len;
+    }
+    // "/path/?*" also matches "/path"
+    return optional && match_upto == len - 1 && strncmp(reference_uri, uri_to_match, len - 1) == 0;
+}
+
+static bool match_exact(const char *reference_uri, const char *uri_to_match, size_t match_upto) {
+    return strlen(reference_uri) == match_upto && strncmp(reference_uri, uri_to_match, match_upto) == 0;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler) {
+    httpd_server_t *server = (httpd_server_t *)handle;
+
+    for (int i = 0; i < server->handler_count; i++) {
+        if (server->handlers[i].method == uri_handler->method &&
+            strcmp(server->handlers[i].uri, uri_handler->uri) == 0) {
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
+    }
+    if (server->handler_count == server->config.max_uri_handlers) {
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    char *uri = strdup(uri_handler->uri);
+    if (uri == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    server->handlers[server->handler_count] = *uri_handler;
+    server->handlers[server->handler_count].uri = uri;
+    server->handler_count++;
+    return ESP_OK;
+}
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg) {
+    httpd_server_t *server = (httpd_server_t *)handle;
+    esp_err_t err = ESP_OK;
+
+    pthread_mutex_lock(&server->lock);
+    if (server->work_count == HTTPD_MAX_WORK) {
+        err = ESP_FAIL;
+    } else {
+        server->work[server->work_count++] = (httpd_work_t){ .fn = work, .arg = arg };
+    }
+    pthread_mutex_unlock(&server->lock);
+    if (err == ESP_OK && write(server->wake[1], "w", 1) != 1) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd) {
+    httpd_server_t *server = (httpd_server_t *)handle;
+
+    // Only called from the server thread (handlers and queued work)
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        if (server->sessions[i].fd == sockfd) {
+            session_close(&server->sessions[i]);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *req) {
+    return ((httpd_req_aux_t *)req->aux)->session->fd;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *req) {
+    const char *query = ((httpd_req_aux_t *)req->aux)->query;
+    return query != NULL ? strlen(query) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len) {
+    const char *query = ((httpd_req_aux_t *)req->aux)->query;
+
+    if (query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    snprintf(buf, buf_len, "%s", query);
+    return strlen(query) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size) {
+    size_t key_len = strlen(key);
+
+    while (qry != NULL && *qry != '\0') {
+        size_t len = strcspn(qry, "&");
+        if (len > key_len && strncmp(qry, key, key_len) == 0 && qry[key_len] == '=') {
+            size_t value_len = len - key_len - 1;
+            snprintf(val, val_size, "%.*s", (int)value_len, qry + key_len + 1);
+            return value_len < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+        qry += len + (qry[len] == '&');
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size) {
+    const char *line = ((httpd_req_aux_t *)req->aux)->headers;
+    size_t field_len = strlen(field);
+
+    while (*line != '\0') {
+        size_t len = strcspn(line, "\r\n");
+        if (len > field_len && strncasecmp(line, field, field_len) == 0 && line[field_len] == ':') {
+            const char *value = line + field_len + 1;
+            while (*value == ' ') {
+                value++;
+            }
+            size_t value_len = line + len - value;
+            snprintf(val, val_size, "%.*s", (int)value_len, value);
+            return value_len < val_size ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+        line += len;
+        line += strspn(line, "\r\n");
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len) {
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+    httpd_session_t *session = aux->session;
+
+    if (buf_len > aux->body_left) {
+        buf_len = aux->body_left;
+    }
+    if (buf_len == 0) {
+        return 0;
+    }
+    // Body bytes received along with the headers come first
+    if (session->in_len > 0) {
+        size_t len = session->in_len < buf_len ? session->in_len : buf_len;
+        memcpy(buf, session->in, len);
+        memmove(session->in, session->in + len, session->in_len - len);
+        session->in_len -= len;
+        aux->body_left -= len;
+        return len;
+    }
+    ssize_t len = recv(session->fd, buf, buf_len, 0);
+    if (len < 0) {
+        return HTTPD_SOCK_ERR_TIMEOUT;
+    }
+    if (len == 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    aux->body_left -= len;
+    return len;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status) {
+    ((httpd_req_aux_t *)req->aux)->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type) {
+    ((httpd_req_aux_t *)req->aux)->type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value) {
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+
+    if (aux->resp_count == HTTPD_MAX_RESP_HEADERS) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    aux->resp_fields[aux->resp_count] = field;
+    aux->resp_values[aux->resp_count] = value;
+    aux->resp_count++;
+    return ESP_OK;
+}
+
+// Status line and headers, with a Content-Length of body_len or chunked when it is negative
+static esp_err_t send_headers(httpd_req_t *req, ssize_t body_len) {
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+    char headers[HTTPD_MAX_HEADERS];
+    int len;
+
+    len = snprintf(headers, sizeof(headers), "HTTP/1.1 %s\r\nContent-Type: %s\r\n", aux->status, aux->type);
+    if (body_len < 0) {
+        len += snprintf(headers + len, sizeof(headers) - len, "Transfer-Encoding: chunked\r\n");
+    } else {
+        len += snprintf(headers + len, sizeof(headers) - len, "Content-Length: %zd\r\n", body_len);
+    }
+    for (int i = 0; i < aux->resp_count && len < (int)sizeof(headers); i++) {
+        if (strcasecmp(aux->resp_fields[i], "Connection") == 0 && strcasecmp(aux->resp_values[i], "close") == 0) {
+            aux->session->close = true;
+        }
+        len += snprintf(headers + len, sizeof(headers) - len, "%s: %s\r\n", aux->resp_fields[i], aux->resp_values[i]);
+    }
+    if (aux->session->close && len < (int)sizeof(headers)) {
+        len += snprintf(headers + len, sizeof(headers) - len, "Connection: close\r\n");
+    }
+    len += snprintf(headers + len, sizeof(headers) - len, "\r\n");
+    if (len >= (int)sizeof(headers)) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    aux->sent_headers = true;
+    if (!send_all(aux->session->fd, headers, len)) {
+        aux->failed = true;
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len) {
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf != NULL ? (ssize_t)strlen(buf) : 0;
+    }
+    if (aux->sent_headers) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+    esp_err_t err = send_headers(req, buf_len);
+    if (err == ESP_OK && buf_len > 0 && !send_all(aux->session->fd, buf, buf_len)) {
+        aux->failed = true;
+        err = ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return err;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len) {
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+    char size[16];
+
+    if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = buf != NULL ? (ssize_t)strlen(buf) : 0;
+    }
+    if (!aux->sent_headers) {
+        esp_err_t err = send_headers(req, -1);
+        if (err != ESP_OK) {
+            return err;
+        }
+        aux->chunked = true;
+    }
+    if (!aux->chunked) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+    // An empty chunk ends the body
+    int len = snprintf(size, sizeof(size), "%zx\r\n", buf_len > 0 ? buf_len : 0);
+    if (!send_all(aux->session->fd, size, len) ||
+        (buf_len > 0 && !send_all(aux->session->fd, buf, buf_len)) ||
+        !send_all(aux->session->fd, "\r\n", 2)) {
+        aux->failed = true;
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg) {
+    static const char *statuses[] = {
+        [HTTPD_400_BAD_REQUEST] = "400 Bad Request",
+        [HTTPD_404_NOT_FOUND] = "404 Not Found",
+        [HTTPD_405_METHOD_NOT_ALLOWED] = "405 Method Not Allowed",
+        [HTTPD_408_REQ_TIMEOUT] = "408 Request Timeout",
+        [HTTPD_500_INTERNAL_SERVER_ERROR] = "500 Internal Server Error",
+    };
+    httpd_req_aux_t *aux = (httpd_req_aux_t *)req->aux;
+
+    aux->status = statuses[error];
+    aux->type = "text/html";
+    // The connection is closed after an error, as the IDF server does
+    aux->session->close = true;
+    return httpd_resp_send(req, msg != NULL ? msg : statuses[error], HTTPD_RESP_USE_STRLEN);
+}
+
+// Read until the end of the headers, which are left NUL terminated in session->in.
+// Returns their length with the blank line, or 0 when the connection is done.
+static size_t read_headers(httpd_session_t *session) {
+    for (;;) {
+        session->in[session->in_len] = '\0';
+        char *end = strstr(session->in, "\r\n\r\n");
+        if (end != NULL) {
+            end[2] = '\0';
+            return end + 4 - session->in;
+        }
+        if (session->in_len == sizeof(session->in) - 1) {
+            return 0;
+        }
+        ssize_t len = recv(session->fd, session->in + session->in_len, sizeof(session->in) - 1 - session->in_len, 0);
+        if (len <= 0) {
+            return 0;
+        }
+        session->in_len += len;
+    }
+}
+
+static const httpd_uri_t *find_handler(httpd_server_t *server, int method, const char *uri, size_t len,
+                                       bool *path_found) {
+    httpd_uri_match_func_t match = server->config.uri_match_fn != NULL ? server->config.uri_match_fn : match_exact;
+
+    *path_found = false;
+    for (int i = 0; i < server->handler_count; i++) {
+        if (match(server->handlers[i].uri, uri, len)) {
+            *path_found = true;
+            if ((int)server->handlers[i].method == method) {
+                return &server->handlers[i];
+            }
+        }
+    }
+    return NULL;
+}
+
+// Serve one request of session, closing it when the connection is done
+static void serve_request(httpd_server_t *server, httpd_session_t *session) {
+    char headers[HTTPD_MAX_HEADERS];
+    char method_name[8];
+    char value[32];
+    httpd_req_aux_t aux = {
+        .session = session,
+        .status = "200 OK",
+        .type = "text/html",
+    };
+    httpd_req_t req = {
+        .handle = server,
+        .method = -1,
+        .aux = &aux,
+        .sess_ctx = session->ctx,
+        .free_ctx = session->free_ctx,
+    };
+
+    size_t headers_len = read_headers(session);
+    if (headers_len == 0) {
+        session_close(session);
+        return;
+    }
+    memcpy(headers, session->in, headers_len);
+    session->in_len -= headers_len;
+    memmove(session->in, session->in + headers_len, session->in_len);
+    session->last_used = ++server->uses;
+
+    int uri_start = 0;
+    int uri_end = 0;
+    if (sscanf(headers, "%7s %n%*s%n HTTP/1.%*d", method_name, &uri_start, &uri_end) != 1 || uri_end == 0 ||
+        uri_end - uri_start > HTTPD_MAX_URI_LEN) {
+        httpd_resp_send_err(&req, HTTPD_400_BAD_REQUEST, NULL);
+        session_close(session);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(method_names) / sizeof(method_names[0]); i++) {
+        if (strcmp(method_name, method_names[i]) == 0) {
+            req.method = (int)i;
+        }
+    }
+    memcpy(req.uri, headers + uri_start, uri_end - uri_start);
+    req.uri[uri_end - uri_start] = '\0';
+    char *query = strchr(req.uri, '?');
+    aux.query = query != NULL ? query + 1 : NULL;
+    aux.headers = headers + strcspn(headers, "\r\n");
+    aux.headers += strspn(aux.headers, "\r\n");
+    if (httpd_req_get_hdr_value_str(&req, "Content-Length", value, sizeof(value)) == ESP_OK) {
+        req.content_len = strtoul(value, NULL, 10);
+    }
+    aux.body_left = req.content_len;
+    if (httpd_req_get_hdr_value_str(&req, "Connection", value, sizeof(value)) == ESP_OK &&
+        strcasecmp(value, "close") == 0) {
+        session->close = true;
+    }
+
+    bool path_found;
+    size_t path_len = query != NULL ? (size_t)(query - req.uri) : strlen(req.uri);
+    const httpd_uri_t *handler = find_handler(server, req.method, req.uri, path_len, &path_found);
+    esp_err_t err;
+    if (handler == NULL) {
+        err = httpd_resp_send_err(&req, path_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND, NULL);
+    } else {
+        req.user_ctx = handler->user_ctx;
+        err = handler->handler(&req);
+    }
+    session->ctx = req.sess_ctx;
+    session->free_ctx = req.free_ctx;
+
+    // A body the handler did not read is dropped so the next request starts at its headers
+    char drain[256];
+    while (err == ESP_OK && aux.body_left > 0) {
+        if (httpd_req_recv(&req, drain, sizeof(drain)) <= 0) {
+            err = ESP_FAIL;
+        }
+    }
+    if (err != ESP_OK || aux.failed || !aux.sent_headers || session->close) {
+        session_close(session);
+    }
+}
+
+static void accept_session(httpd_server_t *server) {
+    struct timeval timeout = { .tv_sec = server->config.recv_wait_timeout };
+    httpd_session_t *free_slot = NULL;
+    httpd_session_t *lru = NULL;
+
+    int fd = accept(server->listener, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        httpd_session_t *session = &server->sessions[i];
+        if (session->fd < 0) {
+            free_slot = session;
+            break;
+        }
+        if (lru == NULL || session->last_used < lru->last_used) {
+            lru = session;
+        }
+    }
+    if (free_slot == NULL && server->config.lru_purge_enable && lru != NULL) {
+        session_close(lru);
+        free_slot = lru;
+    }
+    if (free_slot == NULL) {
+        close(fd);
+        return;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    timeout.tv_sec = server->config.send_wait_timeout;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    *free_slot = (httpd_session_t){ .fd = fd, .last_used = ++server->uses };
+}
+
+static bool run_work(httpd_server_t *server) {
+    httpd_work_t work[HTTPD_MAX_WORK];
+    char wake[HTTPD_MAX_WORK];
+
+    if (read(server->wake[0], wake, sizeof(wake)) < 0) {
+        return true;
+    }
+    pthread_mutex_lock(&server->lock);
+    int count = server->work_count;
+    bool stop = server->stop;
+    memcpy(work, server->work, count * sizeof(work[0]));
+    server->work_count = 0;
+    pthread_mutex_unlock(&server->lock);
+    for (int i = 0; i < count; i++) {
+        work[i].fn(work[i].arg);
+    }
+    return !stop;
+}
+
+static void *server_thread(void *arg) {
+    httpd_server_t *server = (httpd_server_t *)arg;
+    int max = server->config.max_open_sockets;
+    struct pollfd *fds = calloc(max + 2, sizeof(struct pollfd));
+
+    for (bool running = fds != NULL; running;) {
+        bool buffered = false;
+
+        fds[0] = (struct pollfd){ .fd = server->wake[0], .events = POLLIN };
+        fds[1] = (struct pollfd){ .fd = server->listener, .events = POLLIN };
+        for (int i = 0; i < max; i++) {
+            fds[2 + i] = (struct pollfd){ .fd = server->sessions[i].fd, .events = POLLIN };
+            buffered |= server->sessions[i].fd >= 0 && server->sessions[i].in_len > 0;
+        }
+        // Requests already buffered (pipelined) are served without waiting for more bytes
+        if (poll(fds, max + 2, buffered ? 0 : -1) < 0) {
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            running = run_work(server);
+        }
+        for (int i = 0; i < max && running; i++) {
+            httpd_session_t *session = &server->sessions[i];
+            if (session->fd >= 0 && fds[2 + i].fd == session->fd &&
+                (session->in_len > 0 || (fds[2 + i].revents & (POLLIN | POLLHUP | POLLERR)))) {
+                serve_request(server, session);
+            }
+        }
+        if (running && (fds[1].revents & POLLIN)) {
+            accept_session(server);
+        }
+    }
+    free(fds);
+    return NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->server_port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int reuse = 1;
+
+    httpd_server_t *server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    server->config = *config;
+    server->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    server->sessions = calloc(config->max_open_sockets, sizeof(httpd_session_t));
+    server->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (server->handlers == NULL || server->sessions == NULL || server->listener < 0 || pipe(server->wake) != 0) {
+        fprintf(stderr, "httpd: out of resources\n");
+        return ESP_ERR_HTTPD_TASK;
+    }
+    for (int i = 0; i < config->max_open_sockets; i++) {
+        server->sessions[i].fd = -1;
+    }
+    pthread_mutex_init(&server->lock, NULL);
+    setsockopt(server->listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(server->listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(server->listener, config->backlog_conn) != 0) {
+        perror("httpd");
+        return ESP_ERR_HTTPD_TASK;
+    }
+    if (pthread_create(&server->thread, NULL, server_thread, server) != 0) {
+        return ESP_ERR_HTTPD_TASK;
+    }
+    *handle = server;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle) {
+    httpd_server_t *server = (httpd_server_t *)handle;
+
+    pthread_mutex_lock(&server->lock);
+    server->stop = true;
+    pthread_mutex_unlock(&server->lock);
+    if (write(server->wake[1], "s", 1) != 1) {
+        return ESP_FAIL;
+    }
+    pthread_join(server->thread, NULL);
+    for (int i = 0; i < server->config.max_open_sockets; i++) {
+        session_close(&server->sessions[i]);
+    }
+    for (int i = 0; i < server->handler_count; i++) {
+        free((char *)server->handlers[i].uri);
+    }
+    close(server->listener);
+    close(server->wake[0]);
+    close(server->wake[1]);
+    pthread_mutex_destroy(&server->lock);
+    free(server->handlers);
+    free(server->sessions);
+    free(server);
+    return ESP_OK;
+}
@@ -0,0 +1,130 @@
+#ifndef HOST_ESP_HTTP_SERVER_H
+#define HOST_ESP_HTTP_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "esp_err.h"
+
+// HTTP/1.1 server over sockets with the esp_http_server calls of the firmware. Like the
+// IDF one, a single server thread accepts connections, keeps them alive and runs the
+// handlers one request at a time, along with the work queued by httpd_queue_work.
+
+#define ESP_ERR_HTTPD_BASE              0xb000
+#define ESP_ERR_HTTPD_HANDLERS_FULL     (ESP_ERR_HTTPD_BASE + 1)
+#define ESP_ERR_HTTPD_HANDLER_EXISTS    (ESP_ERR_HTTPD_BASE + 2)
+#define ESP_ERR_HTTPD_INVALID_REQ       (ESP_ERR_HTTPD_BASE + 3)
+#define ESP_ERR_HTTPD_RESULT_TRUNC      (ESP_ERR_HTTPD_BASE + 4)
+#define ESP_ERR_HTTPD_RESP_HDR          (ESP_ERR_HTTPD_BASE + 5)
+#define ESP_ERR_HTTPD_RESP_SEND         (ESP_ERR_HTTPD_BASE + 6)
+#define ESP_ERR_HTTPD_TASK              (ESP_ERR_HTTPD_BASE + 8)
+
+// Returned by httpd_req_recv
+#define HTTPD_SOCK_ERR_FAIL     -1
+#define HTTPD_SOCK_ERR_INVALID  -2
+#define HTTPD_SOCK_ERR_TIMEOUT  -3
+
+#define HTTPD_MAX_URI_LEN 512
+#define HTTPD_RESP_USE_STRLEN -1
+
+// Numbered as in http_parser
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+} httpd_method_t;
+
+typedef enum {
+    HTTPD_400_BAD_REQUEST,
+    HTTPD_404_NOT_FOUND,
+    HTTPD_405_METHOD_NOT_ALLOWED,
+    HTTPD_408_REQ_TIMEOUT,
+    HTTPD_500_INTERNAL_SERVER_ERROR,
+} httpd_err_code_t;
+
+typedef void *httpd_handle_t;
+typedef void (*httpd_free_ctx_fn_t)(void *ctx);
+typedef void (*httpd_work_fn_t)(void *arg);
+typedef bool (*httpd_uri_match_func_t)(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+typedef struct httpd_req {
+    httpd_handle_t handle;
+    int method;
+    char uri[HTTPD_MAX_URI_LEN + 1];
+    size_t content_len;
+    void *aux;                      // Connection state of the stand-in
+    void *user_ctx;                 // Of the matched httpd_uri_t
+    void *sess_ctx;                 // Kept with the connection across its requests
+    httpd_free_ctx_fn_t free_ctx;   // Called on sess_ctx when the connection closes
+} httpd_req_t;
+
+typedef struct {
+    const char *uri;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+} httpd_uri_t;
+
+// Fields the stand-in ignores are kept so the firmware's configuration compiles
+typedef struct {
+    unsigned task_priority;
+    size_t stack_size;
+    uint16_t server_port;
+    uint16_t max_open_sockets;
+    uint16_t max_uri_handlers;
+    uint16_t backlog_conn;
+    bool lru_purge_enable;          // Close the least recently used connection when full
+    uint16_t recv_wait_timeout;     // Seconds
+    uint16_t send_wait_timeout;
+    httpd_uri_match_func_t uri_match_fn;    // NULL for exact matches
+} httpd_config_t;
+
+#define HTTPD_DEFAULT_CONFIG() {            \
+        .task_priority = 5,                 \
+        .stack_size = 4096,                 \
+        .server_port = 80,                  \
+        .max_open_sockets = 7,              \
+        .max_uri_handlers = 8,              \
+        .backlog_conn = 5,                  \
+        .lru_purge_enable = false,          \
+        .recv_wait_timeout = 5,             \
+        .send_wait_timeout = 5,             \
+        .uri_match_fn = NULL,               \
+    }
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config);
+esp_err_t httpd_stop(httpd_handle_t handle);
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler);
+
+// "*" at the end of reference_uri matches any rest, "?" before it makes the last character optional
+bool httpd_uri_match_wildcard(const char *reference_uri, const char *uri_to_match, size_t match_upto);
+
+// Run work on the server thread
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg);
+// Close the connection of sockfd from the server thread
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd);
+int httpd_req_to_sockfd(httpd_req_t *req);
+
+size_t httpd_req_get_url_query_len(httpd_req_t *req);
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len);
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size);
+int httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len);
+
+// Status, type and header values are not copied, they must outlive the response
+esp_err_t httpd_resp_set_status(httpd_req_t *req, const char *status);
+esp_err_t httpd_resp_set_type(httpd_req_t *req, const char *type);
+esp_err_t httpd_resp_set_hdr(httpd_req_t *req, const char *field, const char *value);
+esp_err_t httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len);
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg);
+
+#define httpd_resp_sendstr(req, str) httpd_resp_send((req), (str), (str) != NULL ? HTTPD_RESP_USE_STRLEN : 0)
+#define httpd_resp_send_404(req) httpd_resp_send_err((req), HTTPD_404_NOT_FOUND, NULL)
+#define httpd_resp_send_408(req) httpd_resp_send_err((req), HTTPD_408_REQ_TIMEOUT, NULL)
+#define httpd_resp_send_500(req) httpd_resp_send_err((req), HTTPD_500_INTERNAL_SERVER_ERROR, NULL)
+
+#endif // HOST_ESP_HTTP_SERVER_H
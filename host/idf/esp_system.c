@@ -0,0 +1,36 @@
+#include "esp_system.h"
+#include "esp_clk.h"
+#include "esp_http_server.h"
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_HTTPD_RESULT_TRUNC:
+        return "ESP_ERR_HTTPD_RESULT_TRUNC";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+uint32_t esp_get_free_heap_size(void) {
+    return 0;
+}
+
+int esp_clk_cpu_freq(void) {
+    return 0;
+}
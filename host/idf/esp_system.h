@@ -0,0 +1,10 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// 0 on a host, the heap is not tracked
+uint32_t esp_get_free_heap_size(void);
+
+#endif // HOST_ESP_SYSTEM_H
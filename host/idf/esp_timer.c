@@ -0,0 +1,104 @@
+#include "esp_timer.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void *arg;
+    uint64_t period_us;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t stopped;
+    bool running;
+};
+
+int64_t esp_timer_get_time(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *timer) {
+    esp_timer_handle_t t = calloc(1, sizeof(*t));
+    pthread_condattr_t attr;
+
+    if (t == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    t->callback = args->callback;
+    t->arg = args->arg;
+    pthread_mutex_init(&t->lock, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&t->stopped, &attr);
+    pthread_condattr_destroy(&attr);
+    *timer = t;
+    return ESP_OK;
+}
+
+// Fires at whole periods from the start, like the periodic esp_timer
+static void *timer_thread(void *arg) {
+    esp_timer_handle_t t = (esp_timer_handle_t)arg;
+    struct timespec next;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    pthread_mutex_lock(&t->lock);
+    while (t->running) {
+        uint64_t ns = next.tv_nsec + t->period_us * 1000;
+        next.tv_sec += ns / 1000000000;
+        next.tv_nsec = ns % 1000000000;
+        while (t->running && pthread_cond_timedwait(&t->stopped, &t->lock, &next) != ETIMEDOUT) {
+        }
+        if (t->running) {
+            pthread_mutex_unlock(&t->lock);
+            t->callback(t->arg);
+            pthread_mutex_lock(&t->lock);
+        }
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    pthread_mutex_lock(&timer->lock);
+    if (timer->running) {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period_us;
+    timer->running = true;
+    pthread_mutex_unlock(&timer->lock);
+    if (pthread_create(&timer->thread, NULL, timer_thread, timer) != 0) {
+        timer->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+// Waits for a callback in progress, so it must not be called from the callback
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    pthread_mutex_lock(&timer->lock);
+    if (!timer->running) {
+        pthread_mutex_unlock(&timer->lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->running = false;
+    pthread_cond_signal(&timer->stopped);
+    pthread_mutex_unlock(&timer->lock);
+    pthread_join(timer->thread, NULL);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_destroy(&timer->lock);
+    pthread_cond_destroy(&timer->stopped);
+    free(timer);
+    return ESP_OK;
+}
@@ -0,0 +1,6 @@
+#ifndef HOST_ESP_WIFI_H
+#define HOST_ESP_WIFI_H
+
+// Nothing of the Wi-Fi driver is used by the modules built on a host
+
+#endif // HOST_ESP_WIFI_H
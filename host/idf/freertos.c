@@ -0,0 +1,164 @@
+#define _GNU_SOURCE /* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct host_semaphore {
+    pthread_mutex_t lock;
+    pthread_cond_t given;
+    int count;
+};
+
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+} task_start_t;
+
+static void *task_entry(void *arg) {
+    task_start_t start = *(task_start_t *)arg;
+
+    free(arg);
+    start.fn(start.arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle) {
+    pthread_t thread;
+    task_start_t *start = malloc(sizeof(*start));
+
+    if (start == NULL) {
+        return pdFAIL;
+    }
+    start->fn = fn;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, task_entry, start) != 0) {
+        free(start);
+        return pdFAIL;
+    }
+    pthread_detach(thread);
+    if (handle != NULL) {
+        *handle = (TaskHandle_t)thread;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    pthread_exit(NULL);
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority) {
+}
+
+TickType_t xTaskGetTickCount(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (TickType_t)((uint64_t)ts.tv_sec * configTICK_RATE_HZ + ts.tv_nsec / (1000000000 / configTICK_RATE_HZ));
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec ts = {
+        .tv_sec = ticks / configTICK_RATE_HZ,
+        .tv_nsec = (long)(ticks % configTICK_RATE_HZ) * (1000000000 / configTICK_RATE_HZ),
+    };
+
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {
+    }
+}
+
+void vTaskDelayUntil(TickType_t *last_wake, TickType_t period) {
+    TickType_t wake = *last_wake + period;
+    TickType_t now = xTaskGetTickCount();
+
+    // Signed difference so the tick count may wrap
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *last_wake = wake;
+}
+
+static pthread_mutex_t critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void vTaskEnterCritical(void) {
+    pthread_mutex_lock(&critical_lock);
+}
+
+void vTaskExitCritical(void) {
+    pthread_mutex_unlock(&critical_lock);
+}
+
+static SemaphoreHandle_t semaphore_create(int count) {
+    SemaphoreHandle_t sem = malloc(sizeof(*sem));
+
+    if (sem != NULL) {
+        pthread_mutex_init(&sem->lock, NULL);
+        pthread_cond_init(&sem->given, NULL);
+        sem->count = count;
+    }
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return semaphore_create(0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return semaphore_create(1);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    struct timespec deadline;
+    int err = 0;
+
+    if (ticks != portMAX_DELAY) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ticks / configTICK_RATE_HZ;
+        deadline.tv_nsec += (long)(ticks % configTICK_RATE_HZ) * (1000000000 / configTICK_RATE_HZ);
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0 && err == 0) {
+        if (ticks == portMAX_DELAY) {
+            pthread_cond_wait(&sem->given, &sem->lock);
+        } else if (ticks == 0) {
+            err = ETIMEDOUT;
+        } else {
+            err = pthread_cond_timedwait(&sem->given, &sem->lock, &deadline);
+        }
+    }
+    bool taken = sem->count > 0;
+    if (taken) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return taken ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    BaseType_t given = pdFALSE;
+
+    pthread_mutex_lock(&sem->lock);
+    // Binary semaphores and mutexes hold at most one
+    if (sem->count == 0) {
+        sem->count = 1;
+        given = pdTRUE;
+        pthread_cond_signal(&sem->given);
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return given;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    pthread_mutex_destroy(&sem->lock);
+    pthread_cond_destroy(&sem->given);
+    free(sem);
+}
@@ -0,0 +1,25 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include "freertos/portmacro.h"
+
+// The FreeRTOS calls of the firmware over pthreads, one tick per millisecond unless
+// configTICK_RATE_HZ is given (100 as CONFIG_FREERTOS_HZ of the firmware)
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE          1
+#define pdFALSE         0
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define portMAX_DELAY   ((TickType_t)0xffffffffUL)
+#ifndef configTICK_RATE_HZ
+#define configTICK_RATE_HZ 1000
+#endif
+#define pdMS_TO_TICKS(ms) ((TickType_t)((uint64_t)(ms) * configTICK_RATE_HZ / 1000))
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,7 @@
+#ifndef HOST_FREERTOS_PORTMACRO_H
+#define HOST_FREERTOS_PORTMACRO_H
+
+// Code placement attributes have no meaning on a host
+#define IRAM_ATTR
+
+#endif // HOST_FREERTOS_PORTMACRO_H
@@ -0,0 +1,8 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "freertos/FreeRTOS.h"
+
+// Queues are not used by the modules built on a host
+
+#endif // HOST_FREERTOS_QUEUE_H
@@ -0,0 +1,6 @@
+#ifndef HOST_NVS_FLASH_H
+#define HOST_NVS_FLASH_H
+
+// Nothing of NVS is used by the modules built on a host
+
+#endif // HOST_NVS_FLASH_H
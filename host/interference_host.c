@@ -0,0 +1,299 @@
+/*
+ * Host build of the interference mode of /benchmark, driven through main/web_server.c on
+ * the esp_http_server stand-in of host/idf. The program requests
+ * /benchmark?mode=interference&rate=N over HTTP, polls /benchmark/progress until the run
+ * is done and reads the interference object of /benchmark/results. So the benchmark task
+ * runs CoreMark idle and then under main/load_generator.c, and the load GETs and PUTs
+ * /plug/state of the same server, as on the device. It fails when out of range rates are
+ * not rejected, when the progress poll is not answered right away or when load_ok is false.
+ * Sweep, energy and the NVS history are not built on a host; their calls are answered
+ * with ESP_ERR_NOT_SUPPORTED here.
+ */
+#include "benchmark_energy.h"
+#include "benchmark_history.h"
+#include "benchmark_sweep.h"
+#include "core_main.h"
+#include "json_reader.h"
+#include "web_server.h"
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef WEB_SERVER_PORT
+#error "Build with -DWEB_SERVER_PORT=<port>, web_server.c listens on port 80 otherwise"
+#endif
+
+#define DEFAULT_RATE 10
+#define REPLY_SIZE 4096
+#define POLL_MS 500
+#define MAX_POLL_MS 200         // A progress poll is answered without waiting for chunks
+#define REQUEST_TIMEOUT_SECS 30
+
+SemaphoreHandle_t mutex;
+
+static int plug_state = 0;      // Only accessed with mutex held
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// As handle_get_state of smart_plug_actions.c, without the sensor
+static esp_err_t handle_get_state(const action_request_t *request, json_writer_t *response) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    int state = plug_state;
+    xSemaphoreGive(mutex);
+
+    json_obj_begin(response, NULL);
+    json_int(response, "state", state);
+    json_obj_end(response);
+    return ESP_OK;
+}
+
+static esp_err_t handle_put_state(const action_request_t *request, json_writer_t *response) {
+    int32_t state;
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = &state, .min = 0, .max = 1, .required = true },
+    };
+
+    if (request->body == NULL ||
+        json_parse_object(request->body, request->body_len, fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    plug_state = state;
+    xSemaphoreGive(mutex);
+
+    json_obj_begin(response, NULL);
+    json_int(response, "state", state);
+    json_obj_end(response);
+    return ESP_OK;
+}
+
+// The benchmark records read it outside the mutex, like plug_get_state
+static int get_state(void) {
+    return __atomic_load_n(&plug_state, __ATOMIC_RELAXED);
+}
+
+static const device_endpoint_t plug_endpoints[] = {
+    { .uri = "/state", .method = ACTION_GET, .handler = handle_get_state, .description = "Get plug state" },
+    { .uri = "/state", .method = ACTION_PUT, .handler = handle_put_state, .description = "Set plug state" },
+};
+
+const device_config_t DEVICE_CONFIG = {
+    .device_type = "plug",
+    .endpoints = plug_endpoints,
+    .num_endpoints = sizeof(plug_endpoints) / sizeof(plug_endpoints[0]),
+    .get_state = get_state,
+};
+
+esp_err_t benchmark_history_init(void) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+uint32_t benchmark_history_boot_count(void) {
+    return 0;
+}
+
+esp_err_t benchmark_history_add(const benchmark_record_t *record) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+int benchmark_history_get(benchmark_record_t *records, int max) {
+    return 0;
+}
+
+int benchmark_sweep_default_freqs(uint32_t *freqs, int max) {
+    return 0;
+}
+
+void benchmark_sweep_run(const uint32_t *freqs, int count, benchmark_energy_power_fn_t power,
+                         benchmark_energy_counter_fn_t counter, benchmark_sweep_point_t *points) {
+    for (int i = 0; i < count; i++) {
+        points[i] = (benchmark_sweep_point_t){ .cpu_mhz = freqs[i], .err = ESP_ERR_NOT_SUPPORTED };
+    }
+}
+
+esp_err_t benchmark_energy_start(benchmark_energy_power_fn_t power, benchmark_energy_counter_fn_t counter) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t benchmark_energy_stop(float iterations_per_sec, benchmark_energy_t *energy) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+// Undo the chunked transfer encoding of body in place
+static void dechunk(char *body) {
+    char *in = body;
+    char *out = body;
+
+    for (;;) {
+        char *end;
+        unsigned long size = strtoul(in, &end, 16);
+        if (end == in || strncmp(end, "\r\n", 2) != 0 || size == 0 || strlen(end + 2) < size) {
+            break;
+        }
+        memmove(out, end + 2, size);
+        out += size;
+        in = end + 2 + size + 2;
+    }
+    *out = '\0';
+}
+
+// GET path from the server, the body is left NUL terminated in body. Returns the status, 0 on failure.
+static int http_get(const char *path, char *body, size_t size) {
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(WEB_SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    struct timeval timeout = { .tv_sec = REQUEST_TIMEOUT_SECS };
+    char reply[REPLY_SIZE];
+    size_t len = 0;
+    ssize_t n = 0;
+    int status = 0;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int request_len = snprintf(reply, sizeof(reply), "GET %s HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n", path);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0 && send(fd, reply, request_len, MSG_NOSIGNAL) == request_len) {
+        while (len < sizeof(reply) - 1 && (n = recv(fd, reply + len, sizeof(reply) - 1 - len, 0)) > 0) {
+            len += n;
+        }
+    }
+    close(fd);
+    reply[len] = '\0';
+    char *start = strstr(reply, "\r\n\r\n");
+    if (n != 0 || start == NULL || sscanf(reply, "HTTP/1.%*d %d", &status) != 1) {
+        return 0;
+    }
+    *start = '\0';
+    snprintf(body, size, "%s", start + 4);
+    if (strstr(reply, "Transfer-Encoding: chunked") != NULL) {
+        dechunk(body);
+    }
+    return status;
+}
+
+// The object value of key in json, which must not hold braces in strings. Returns its
+// length and sets start, 0 when absent.
+static size_t find_object(const char *json, const char *key, const char **start) {
+    char member[32];
+    int depth = 0;
+
+    snprintf(member, sizeof(member), "\"%s\":{", key);
+    const char *p = strstr(json, member);
+    if (p == NULL) {
+        return 0;
+    }
+    *start = p + strlen(member) - 1;
+    for (p = *start; *p != '\0'; p++) {
+        depth += (*p == '{') - (*p == '}');
+        if (depth == 0) {
+            return p + 1 - *start;
+        }
+    }
+    return 0;
+}
+
+static bool check_rejected(const char *path) {
+    char body[REPLY_SIZE];
+    int status = http_get(path, body, sizeof(body));
+
+    if (status != 400) {
+        printf("ERROR! %s answered %d, expected 400\n", path, status);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    char path[96];
+    char body[REPLY_SIZE];
+    unsigned rate = DEFAULT_RATE;
+
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-' && argv[i][1] == 'c') {
+            default_num_contexts = (ee_u32)strtoul(&argv[i][2], NULL, 0);
+        } else {
+            rate = (unsigned)strtoul(argv[i], NULL, 0);
+        }
+    }
+    mutex = xSemaphoreCreateMutex();
+    httpd_handle_t server = start_webserver();
+    if (server == NULL) {
+        return 1;
+    }
+
+    bool ok = check_rejected("/benchmark?mode=interference&rate=0") &&
+              check_rejected("/benchmark?mode=interference&rate=51");
+    snprintf(path, sizeof(path), "/benchmark?mode=interference&rate=%u", rate);
+    if (ok && http_get(path, body, sizeof(body)) != 200) {
+        printf("ERROR! %s failed: %s\n", path, body);
+        ok = false;
+    }
+
+    // Poll the progress until the run is done, each poll must be answered right away
+    int32_t seq = 0;
+    bool running = true;
+    double slowest = 0;
+    while (ok && running) {
+        const json_field_t fields[] = {
+            { .key = "running", .type = JSON_FIELD_BOOL, .value = &running, .required = true },
+            { .key = "seq", .type = JSON_FIELD_INT, .value = &seq, .min = 0, .max = INT32_MAX, .required = true },
+        };
+        usleep(POLL_MS * 1000);
+        snprintf(path, sizeof(path), "/benchmark/progress?since=%d", (int)seq);
+        double start = now_secs();
+        if (http_get(path, body, sizeof(body)) != 200 ||
+            json_parse_object(body, strlen(body), fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+            printf("ERROR! %s failed: %s\n", path, body);
+            ok = false;
+        }
+        if (now_secs() - start > slowest) {
+            slowest = now_secs() - start;
+        }
+    }
+    if (ok && slowest * 1000 > MAX_POLL_MS) {
+        printf("ERROR! A progress poll took %.0f ms\n", slowest * 1000);
+        ok = false;
+    }
+
+    const char *interference = NULL;
+    size_t len = 0;
+    if (ok && (http_get("/benchmark/results", body, sizeof(body)) != 200 ||
+               (len = find_object(body, "interference", &interference)) == 0)) {
+        printf("ERROR! No interference result: %s\n", body);
+        ok = false;
+    }
+    if (ok) {
+        int32_t requests = 0;
+        int32_t failures = 0;
+        bool load_ok = false;
+        const json_field_t fields[] = {
+            { .key = "requests", .type = JSON_FIELD_INT, .value = &requests, .min = 0, .max = INT32_MAX, .required = true },
+            { .key = "failures", .type = JSON_FIELD_INT, .value = &failures, .min = 0, .max = INT32_MAX, .required = true },
+            { .key = "load_ok", .type = JSON_FIELD_BOOL, .value = &load_ok, .required = true },
+        };
+        printf("\n=== Interference ===\n%.*s\n", (int)len, interference);
+        printf("Slowest progress poll: %.1f ms\n", slowest * 1000);
+        if (json_parse_object(interference, len, fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+            printf("ERROR! Malformed interference result\n");
+            ok = false;
+        } else if (!load_ok) {
+            printf("ERROR! The load did not reach the server: %d requests, %d failed\n", (int)requests, (int)failures);
+            ok = false;
+        }
+    }
+    stop_webserver(server);
+    return ok ? 0 : 1;
+}
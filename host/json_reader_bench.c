@@ -0,0 +1,89 @@
+/*
+ * Parse time of the request bodies of PUT /plug/state and of a full /plug/batch, with the
+ * same field tables as the firmware.
+ */
+#include "json_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ROUNDS 1000000
+#define BATCH_MAX_OPS 16        // DEVICE_BATCH_MAX_OPS
+#define NUM_OUTPUTS 16
+
+typedef struct {
+    int32_t output;
+    int32_t state;
+} op_t;
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static esp_err_t parse_state(const char *buf, size_t len, void *ctx) {
+    int32_t *state = (int32_t *)ctx;
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = state, .min = 0, .max = 1, .required = true },
+    };
+    return json_parse_object(buf, len, fields, sizeof(fields) / sizeof(fields[0]), NULL);
+}
+
+static esp_err_t parse_op(void *ctx, size_t index, const char *buf, size_t len) {
+    if (index >= BATCH_MAX_OPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    op_t *op = &((op_t *)ctx)[index];
+    op->output = 0;
+    const json_field_t fields[] = {
+        { .key = "output", .type = JSON_FIELD_INT, .value = &op->output, .min = 0, .max = NUM_OUTPUTS - 1 },
+        { .key = "state", .type = JSON_FIELD_INT, .value = &op->state, .min = 0, .max = 1, .required = true },
+    };
+    return json_parse_object(buf, len, fields, sizeof(fields) / sizeof(fields[0]), NULL);
+}
+
+static esp_err_t parse_batch(const char *buf, size_t len, void *ctx) {
+    return json_parse_array(buf, len, parse_op, ctx);
+}
+
+static void run(const char *name, const char *body, esp_err_t (*parse)(const char *, size_t, void *),
+                void *ctx, long rounds) {
+    size_t len = strlen(body);
+
+    if (parse(body, len, ctx) != ESP_OK) {
+        printf("%-11s: parse failed\n", name);
+        return;
+    }
+    double start = now_secs();
+    for (long i = 0; i < rounds; i++) {
+        parse(body, len, ctx);
+    }
+    double secs = now_secs() - start;
+    printf("%-11s: %4zu bytes, %8.1f ns per parse, %7.1f MB/s\n",
+           name, len, secs * 1e9 / rounds, len * rounds / secs / 1e6);
+}
+
+int main(int argc, char *argv[]) {
+    long rounds = argc > 1 ? atol(argv[1]) : DEFAULT_ROUNDS;
+    static char batch[JSON_READER_MAX_BODY];
+    static op_t ops[BATCH_MAX_OPS];
+    int32_t state;
+
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+    // The largest batch that fits JSON_READER_MAX_BODY
+    size_t len = snprintf(batch, sizeof(batch), "[");
+    for (int i = 0; i < BATCH_MAX_OPS; i++) {
+        len += snprintf(batch + len, sizeof(batch) - len, "%s{\"output\":%d,\"state\":%d}",
+                        i > 0 ? "," : "", i % NUM_OUTPUTS, i & 1);
+    }
+    snprintf(batch + len, sizeof(batch) - len, "]");
+
+    run("plug/state", "{\"state\": 1}", parse_state, &state, rounds);
+    run("plug/batch", batch, parse_batch, ops, rounds / BATCH_MAX_OPS > 0 ? rounds / BATCH_MAX_OPS : 1);
+    return 0;
+}
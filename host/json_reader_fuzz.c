@@ -0,0 +1,184 @@
+/*
+ * Fuzz target for main/json_reader.c. Each input is parsed as a request object and as a
+ * /plug/batch array from an exactly sized heap copy, so a sanitizer catches any read past
+ * the body, and the fields stored by a successful parse are checked against their bounds.
+ * Built as is, main mutates a corpus of typical bodies at random; built with clang
+ * -fsanitize=fuzzer -DLIBFUZZER, libFuzzer drives LLVMFuzzerTestOneInput instead.
+ */
+#include "json_reader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_RUNS 1000000
+#define MAX_INPUT (2 * JSON_READER_MAX_BODY)
+#define MAX_MUTATIONS 8
+#define BATCH_MAX_OPS 16
+
+typedef struct {
+    int32_t state;
+    int32_t output;
+    bool on;
+    char name[8];
+} request_t;
+
+static void check(bool ok, const char *what, const uint8_t *data, size_t size) {
+    if (!ok) {
+        fprintf(stderr, "%s for input: %.*s\n", what, (int)size, (const char *)data);
+        abort();
+    }
+}
+
+static esp_err_t parse_request(const char *buf, size_t len, request_t *r, uint32_t *seen) {
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = &r->state, .min = 0, .max = 1, .required = true },
+        { .key = "output", .type = JSON_FIELD_INT, .value = &r->output, .min = -5, .max = 1000 },
+        { .key = "on", .type = JSON_FIELD_BOOL, .value = &r->on },
+        { .key = "name", .type = JSON_FIELD_STR, .value = r->name, .size = sizeof(r->name) },
+    };
+    return json_parse_object(buf, len, fields, sizeof(fields) / sizeof(fields[0]), seen);
+}
+
+static esp_err_t parse_op(void *ctx, size_t index, const char *buf, size_t len) {
+    request_t *ops = (request_t *)ctx;
+    uint32_t seen = 0;
+
+    if (index >= BATCH_MAX_OPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(&ops[index], 0xa5, sizeof(ops[index]));
+    esp_err_t err = parse_request(buf, len, &ops[index], &seen);
+    if (err == ESP_OK) {
+        const request_t *r = &ops[index];
+        if (!(seen & 1) || r->state < 0 || r->state > 1 ||
+            ((seen & 2) && (r->output < -5 || r->output > 1000)) ||
+            ((seen & 8) && memchr(r->name, '\0', sizeof(r->name)) == NULL)) {
+            return ESP_FAIL;
+        }
+    }
+    return err;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static request_t ops[BATCH_MAX_OPS];
+    request_t r;
+    uint32_t seen = 0;
+
+    // No NUL terminator, the parser must stay within len
+    char *buf = malloc(size > 0 ? size : 1);
+    memcpy(buf, data, size);
+
+    memset(&r, 0xa5, sizeof(r));
+    esp_err_t err = parse_request(buf, size, &r, &seen);
+    check(err == ESP_OK || err == ESP_ERR_INVALID_ARG || err == ESP_ERR_INVALID_SIZE ||
+          err == ESP_ERR_NOT_FOUND, "Unexpected error", data, size);
+    if (err == ESP_OK) {
+        check(seen & 1, "Required member not seen", data, size);
+        check(r.state >= 0 && r.state <= 1, "state out of range", data, size);
+        check(!(seen & 2) || (r.output >= -5 && r.output <= 1000), "output out of range", data, size);
+        check(!(seen & 8) || memchr(r.name, '\0', sizeof(r.name)) != NULL, "name not terminated", data, size);
+    }
+    err = json_parse_array(buf, size, parse_op, ops);
+    check(err != ESP_FAIL, "Batch operation out of bounds", data, size);
+    free(buf);
+    return 0;
+}
+
+#ifndef LIBFUZZER
+// Typical bodies of the plug endpoints and a few edge cases to mutate from
+static const char *corpus[] = {
+    "{\"state\": 1}",
+    "{\"state\":0,\"output\":3}",
+    "{ \"name\" : \"relay\\u00e9\\n\", \"state\" : 1, \"on\" : true }",
+    "{\"state\":1,\"extra\":{\"a\":[1,2,{\"b\":null}],\"c\":\"\\\"}\"},\"on\":false}",
+    "[{\"output\": 0, \"state\": 1}, {\"output\": 1, \"state\": 0}]",
+    "[{\"state\":1},{\"state\":0,\"output\":-1e3},{\"state\":1,\"name\":\"x\"}]",
+    "{\"state\":-0,\"output\":2147483648}",
+    "[]",
+    "{}",
+};
+
+// JSON punctuation is inserted more often than other bytes so mutants still look like JSON
+static const char alphabet[] = "{}[]:,\"\\ 0123456789-+.eEtruefalsn";
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 32);
+}
+
+static size_t mutate(uint8_t *buf, size_t len) {
+    int mutations = 1 + rng() % MAX_MUTATIONS;
+
+    for (int i = 0; i < mutations; i++) {
+        size_t pos = len > 0 ? rng() % len : 0;
+        switch (rng() % 6) {
+        case 0:     // Flip a bit
+            if (len > 0) {
+                buf[pos] ^= 1 << (rng() % 8);
+            }
+            break;
+        case 1:     // Replace a byte
+            if (len > 0) {
+                buf[pos] = rng() % 2 ? alphabet[rng() % (sizeof(alphabet) - 1)] : (uint8_t)rng();
+            }
+            break;
+        case 2:     // Insert a byte
+            if (len < MAX_INPUT) {
+                memmove(buf + pos + 1, buf + pos, len - pos);
+                buf[pos] = alphabet[rng() % (sizeof(alphabet) - 1)];
+                len++;
+            }
+            break;
+        case 3:     // Delete a byte
+            if (len > 0) {
+                memmove(buf + pos, buf + pos + 1, len - pos - 1);
+                len--;
+            }
+            break;
+        case 4:     // Duplicate a slice
+            if (len > 0) {
+                size_t n = 1 + rng() % (len - pos);
+                if (len + n <= MAX_INPUT) {
+                    memmove(buf + pos + n, buf + pos, len - pos);
+                    len += n;
+                }
+            }
+            break;
+        default:    // Truncate
+            len = pos;
+            break;
+        }
+    }
+    return len;
+}
+
+int main(int argc, char *argv[]) {
+    long runs = argc > 1 ? atol(argv[1]) : DEFAULT_RUNS;
+    static uint8_t buf[MAX_INPUT];
+    size_t corpus_size = sizeof(corpus) / sizeof(corpus[0]);
+
+    if (argc > 2) {
+        rng_state = strtoull(argv[2], NULL, 0) | 1;
+    }
+    if (runs <= 0) {
+        fprintf(stderr, "usage: %s [runs] [seed]\n", argv[0]);
+        return 1;
+    }
+    for (size_t i = 0; i < corpus_size; i++) {
+        LLVMFuzzerTestOneInput((const uint8_t *)corpus[i], strlen(corpus[i]));
+    }
+    for (long i = 0; i < runs; i++) {
+        const char *seed = corpus[rng() % corpus_size];
+        size_t len = strlen(seed);
+        memcpy(buf, seed, len);
+        len = mutate(buf, len);
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+    printf("%ld inputs parsed\n", runs + (long)corpus_size);
+    return 0;
+}
+#endif
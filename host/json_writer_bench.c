@@ -0,0 +1,223 @@
+/*
+ * Heap allocations and time per /benchmark/results response, built with json_writer into
+ * the 512 byte buffer of the firmware and, when compiled with -DWITH_CJSON, the way it was
+ * built before: a cJSON tree printed with cJSON_Print. Allocations are counted by wrapping
+ * malloc, calloc, realloc and free at link time.
+ */
+#include "json_writer.h"
+#if WITH_CJSON
+#include "cJSON.h"
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_ROUNDS 200000
+#define RESPONSE_BUFFER_SIZE 512    // resp_buf of web_server.c
+#define CONTEXTS 2
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static unsigned long allocations;
+
+void *__wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+    allocations++;
+    return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+}
+
+void __wrap_free(void *ptr) {
+    __real_free(ptr);
+}
+
+// The fields add_benchmark_result serializes
+typedef struct {
+    double iterations_per_sec;
+    double coremark_per_mhz;
+    double cpu_mhz;
+    const char *timer;
+    uint32_t iterations;
+    uint32_t contexts;
+    uint32_t size;
+    uint32_t data_size;
+    int16_t seeds[3];
+    uint32_t execs;
+    int64_t ticks;
+    double total_secs;
+    double wall_secs;
+    int32_t errors;
+    bool valid;
+    int32_t known_id;
+    const char *profile;
+    uint16_t seedcrc;
+    uint16_t crcs[4][CONTEXTS];
+} result_t;
+
+static const char *crc_names[4] = {"crclist", "crcmatrix", "crcstate", "crcfinal"};
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// A 2K performance run on two contexts, varied a little every round
+static void sample(result_t *r, long round) {
+    *r = (result_t){
+        .iterations_per_sec = 1234.5678 + (round & 7),
+        .coremark_per_mhz = 7.716,
+        .cpu_mhz = 160,
+        .timer = "esp_timer",
+        .iterations = 20000,
+        .contexts = CONTEXTS,
+        .size = 666,
+        .data_size = 2000,
+        .seeds = {0, 0, 0x66},
+        .execs = 7,
+        .ticks = 16201000 + round,
+        .total_secs = 16.201,
+        .wall_secs = 16.25,
+        .errors = 0,
+        .valid = true,
+        .known_id = 3,
+        .profile = "2k-performance",
+        .seedcrc = 0xe9f5,
+        .crcs = {{0xe714, 0xe714}, {0x1fd7, 0x1fd7}, {0x8e3a, 0x8e3a}, {0xff48, 0xff48}},
+    };
+}
+
+static esp_err_t discard(void *ctx, const char *data, size_t len) {
+    *(size_t *)ctx += len;
+    return ESP_OK;
+}
+
+static size_t respond_writer(const result_t *r) {
+    static char buf[RESPONSE_BUFFER_SIZE];
+    size_t sent = 0;
+    json_writer_t w;
+
+    json_writer_init(&w, buf, sizeof(buf), discard, &sent);
+    json_obj_begin(&w, NULL);
+    json_bool(&w, "running", false);
+    json_str(&w, "mode", "plain");
+    json_double(&w, "iterations_per_sec", r->iterations_per_sec);
+    json_double(&w, "coremark_per_mhz", r->coremark_per_mhz);
+    json_double(&w, "cpu_mhz", r->cpu_mhz);
+    json_str(&w, "timer", r->timer);
+    json_uint(&w, "iterations", r->iterations);
+    json_uint(&w, "contexts", r->contexts);
+    json_uint(&w, "size", r->size);
+    json_uint(&w, "data_size", r->data_size);
+    json_arr_begin(&w, "seeds");
+    for (int i = 0; i < 3; i++) {
+        json_int(&w, NULL, r->seeds[i]);
+    }
+    json_arr_end(&w);
+    json_uint(&w, "algorithms", r->execs);
+    json_int(&w, "ticks", r->ticks);
+    json_double(&w, "total_time_seconds", r->total_secs);
+    json_double(&w, "wall_time_seconds", r->wall_secs);
+    json_int(&w, "error_count", r->errors);
+    json_bool(&w, "valid", r->valid);
+    json_int(&w, "known_id", r->known_id);
+    json_str(&w, "profile", r->profile);
+    json_uint(&w, "seedcrc", r->seedcrc);
+    for (int k = 0; k < 4; k++) {
+        json_arr_begin(&w, crc_names[k]);
+        for (uint32_t i = 0; i < r->contexts; i++) {
+            json_uint(&w, NULL, r->crcs[k][i]);
+        }
+        json_arr_end(&w);
+    }
+    json_obj_end(&w);
+    json_writer_flush(&w);
+    return sent;
+}
+
+#if WITH_CJSON
+static size_t respond_cjson(const result_t *r) {
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddBoolToObject(root, "running", false);
+    cJSON_AddStringToObject(root, "mode", "plain");
+    cJSON_AddNumberToObject(root, "iterations_per_sec", r->iterations_per_sec);
+    cJSON_AddNumberToObject(root, "coremark_per_mhz", r->coremark_per_mhz);
+    cJSON_AddNumberToObject(root, "cpu_mhz", r->cpu_mhz);
+    cJSON_AddStringToObject(root, "timer", r->timer);
+    cJSON_AddNumberToObject(root, "iterations", r->iterations);
+    cJSON_AddNumberToObject(root, "contexts", r->contexts);
+    cJSON_AddNumberToObject(root, "size", r->size);
+    cJSON_AddNumberToObject(root, "data_size", r->data_size);
+    cJSON *seeds = cJSON_CreateArray();
+    for (int i = 0; i < 3; i++) {
+        cJSON_AddItemToArray(seeds, cJSON_CreateNumber(r->seeds[i]));
+    }
+    cJSON_AddItemToObject(root, "seeds", seeds);
+    cJSON_AddNumberToObject(root, "algorithms", r->execs);
+    cJSON_AddNumberToObject(root, "ticks", (double)r->ticks);
+    cJSON_AddNumberToObject(root, "total_time_seconds", r->total_secs);
+    cJSON_AddNumberToObject(root, "wall_time_seconds", r->wall_secs);
+    cJSON_AddNumberToObject(root, "error_count", r->errors);
+    cJSON_AddBoolToObject(root, "valid", r->valid);
+    cJSON_AddNumberToObject(root, "known_id", r->known_id);
+    cJSON_AddStringToObject(root, "profile", r->profile);
+    cJSON_AddNumberToObject(root, "seedcrc", r->seedcrc);
+    for (int k = 0; k < 4; k++) {
+        cJSON *array = cJSON_CreateArray();
+        for (uint32_t i = 0; i < r->contexts; i++) {
+            cJSON_AddItemToArray(array, cJSON_CreateNumber(r->crcs[k][i]));
+        }
+        cJSON_AddItemToObject(root, crc_names[k], array);
+    }
+    char *json = cJSON_Print(root);
+    cJSON_Delete(root);
+    size_t len = json != NULL ? strlen(json) : 0;
+    cJSON_free(json);
+    return len;
+}
+#endif
+
+static void run(const char *name, size_t (*respond)(const result_t *), long rounds) {
+    result_t r;
+    volatile size_t sink = 0;
+
+    sample(&r, 0);
+    size_t len = respond(&r);
+    allocations = 0;
+    double start = now_secs();
+    for (long i = 0; i < rounds; i++) {
+        sample(&r, i);
+        sink += respond(&r);
+    }
+    double secs = now_secs() - start;
+    printf("%-11s: %4zu bytes, %6.2f allocations, %8.1f ns per response\n",
+           name, len, (double)allocations / rounds, secs * 1e9 / rounds);
+}
+
+int main(int argc, char *argv[]) {
+    long rounds = argc > 1 ? atol(argv[1]) : DEFAULT_ROUNDS;
+
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+    run("json_writer", respond_writer, rounds);
+#if WITH_CJSON
+    run("cJSON", respond_cjson, rounds);
+#else
+    printf("cJSON       : not built, add -DWITH_CJSON with the cJSON sources of the SDK\n");
+#endif
+    return 0;
+}
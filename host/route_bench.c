@@ -0,0 +1,128 @@
+/*
+ * Build (displacement search) and lookup time of main/route_table.c for synthetic endpoint
+ * sets, next to the linear scan over the endpoints that one registered handler per endpoint
+ * amounts to. Every route is checked to be found, and unknown paths to miss.
+ */
+#include "route_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DEFAULT_LOOKUPS 4000000
+#define MAX_ROUTES 4096
+#define URI_SIZE 32
+
+static const int route_counts[] = {8, 64, 512, 4096};
+
+static char uris[MAX_ROUTES][URI_SIZE];
+static char misses[MAX_ROUTES][URI_SIZE];
+static device_endpoint_t endpoints[MAX_ROUTES];
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static esp_err_t no_action(const action_request_t *request, json_writer_t *response) {
+    return ESP_OK;
+}
+
+// Paths shaped like the plug ones, every fourth endpoint a PUT on the path of a GET
+static void make_routes(int count) {
+    static const char *names[] = {"state", "power", "history", "energy", "config", "batch"};
+
+    for (int i = 0; i < count; i++) {
+        int path = i - (i % 4 == 3);
+        snprintf(uris[i], URI_SIZE, "/%s/%d", names[path % 6], path / 6);
+        snprintf(misses[i], URI_SIZE, "/%s/%d", names[path % 6], path / 6 + MAX_ROUTES);
+        endpoints[i] = (device_endpoint_t){
+            .uri = uris[i],
+            .method = i % 4 == 3 ? ACTION_PUT : ACTION_GET,
+            .handler = no_action,
+        };
+    }
+}
+
+static const device_endpoint_t *linear_lookup(int count, action_method_t method, const char *uri, size_t len) {
+    for (int i = 0; i < count; i++) {
+        if (endpoints[i].method == method && strncmp(endpoints[i].uri, uri, len) == 0 &&
+            endpoints[i].uri[len] == '\0') {
+            return &endpoints[i];
+        }
+    }
+    return NULL;
+}
+
+static int bench(int count, long lookups) {
+    route_table_t table = {0};
+    size_t lens[MAX_ROUTES];
+    volatile uintptr_t sink = 0;
+    int builds = 0;
+
+    make_routes(count);
+    for (int i = 0; i < count; i++) {
+        lens[i] = strlen(uris[i]);
+    }
+
+    // Builds are repeated for at least 0.2 sec so small tables get a stable figure
+    double start = now_secs();
+    double build_secs;
+    do {
+        if (route_table_build(&table, endpoints, count) != ESP_OK) {
+            printf("| %-6d | build failed\n", count);
+            return 1;
+        }
+        builds++;
+        build_secs = now_secs() - start;
+    } while (build_secs < 0.2);
+    build_secs /= builds;
+
+    for (int i = 0; i < count; i++) {
+        if (route_table_lookup(&table, endpoints[i].method, uris[i], lens[i]) != &endpoints[i] ||
+            route_table_lookup(&table, endpoints[i].method, misses[i], strlen(misses[i])) != NULL) {
+            printf("| %-6d | wrong lookup for %s\n", count, uris[i]);
+            return 1;
+        }
+    }
+
+    start = now_secs();
+    for (long n = 0; n < lookups; n++) {
+        int i = (int)((n * 2654435761u) % count);
+        sink += (uintptr_t)route_table_lookup(&table, endpoints[i].method, uris[i], lens[i]);
+    }
+    double lookup_ns = (now_secs() - start) * 1e9 / lookups;
+
+    // The scan gets fewer rounds, it is linear in the endpoint count
+    long scans = lookups / (count / 8 > 0 ? count / 8 : 1);
+    start = now_secs();
+    for (long n = 0; n < scans; n++) {
+        int i = (int)((n * 2654435761u) % count);
+        sink += (uintptr_t)linear_lookup(count, endpoints[i].method, uris[i], lens[i]);
+    }
+    double scan_ns = (now_secs() - start) * 1e9 / scans;
+
+    size_t bytes = (table.mask + 1) * sizeof(table.slots[0]) +
+                   (table.bucket_mask + 1) * sizeof(table.displacements[0]);
+    printf("| %-6d | %-5u | %-5u | %-4u | %10.1f | %9.1f | %9.1f |\n", count, table.mask + 1,
+           (unsigned)bytes, table.seed, build_secs * 1e6, lookup_ns, scan_ns);
+    route_table_free(&table);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    long lookups = argc > 1 ? atol(argv[1]) : DEFAULT_LOOKUPS;
+    int failed = 0;
+
+    if (lookups <= 0) {
+        fprintf(stderr, "usage: %s [lookups]\n", argv[0]);
+        return 1;
+    }
+    printf("| Routes | Slots | Bytes | Seed | Build (us) | Lookup ns | Linear ns |\n");
+    printf("| :----- | :---- | :---- | :--- | :--------- | :-------- | :-------- |\n");
+    for (size_t i = 0; i < sizeof(route_counts) / sizeof(route_counts[0]); i++) {
+        failed |= bench(route_counts[i], lookups);
+    }
+    return failed;
+}
@@ -0,0 +1,30 @@
+#!/bin/bash
+# Build the host benchmark once per optimization flavour and print the scores as a
+# markdown table, the host counterpart of /benchmark?mode=sweep.
+# Usage: host/sweep.sh [contexts] [flags...]   e.g. host/sweep.sh 1 -O0 -O2 -O3
+
+set -e
+cd "$(dirname "$0")/.."
+
+CONTEXTS=${1:-1}
+shift || true
+FLAVOURS=("$@")
+if [ ${#FLAVOURS[@]} -eq 0 ]; then
+    FLAVOURS=(-O0 -O2 -O3 -Os)
+fi
+SOURCES="main/core_list_join.c main/core_main.c main/core_matrix.c main/core_state.c main/core_util.c main/core_portme.c"
+BIN=$(mktemp)
+trap 'rm -f "$BIN"' EXIT
+
+echo "| Flags      | Contexts | CoreMark     | CoreMark/MHz | Valid |"
+echo "| :--------- | :------- | :----------- | :----------- | :---- |"
+for flags in "${FLAVOURS[@]}"; do
+    # The cycle counter timer gives CoreMark/MHz against the measured counter rate
+    gcc $flags -Imain -DPERFORMANCE_RUN=1 -DMULTITHREAD=$CONTEXTS -DUSE_PTHREAD=1 -DCORE_TIMER=1 \
+        -DCOMPILER_FLAGS="\"$flags\"" $SOURCES -lpthread -o "$BIN"
+    out=$("$BIN" -c"$CONTEXTS")
+    score=$(echo "$out" | awk -F: '/^Iterations\/Sec/ {gsub(/ /, "", $2); print $2; exit}')
+    per_mhz=$(echo "$out" | awk '/^CoreMark\/MHz/ {print $3; exit}')
+    valid=$(echo "$out" | grep -q "Correct operation validated" && echo yes || echo no)
+    printf "| %-10s | %-8s | %-12s | %-12s | %-5s |\n" "$flags" "$CONTEXTS" "$score" "${per_mhz:-n/a}" "$valid"
+done
@@ -0,0 +1,73 @@
+/*
+ * Compares the JSON and binary encodings of GET /plug/state: bytes on the wire and
+ * encode time. Both go through the same functions as the firmware.
+ */
+#include "plug_telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DEFAULT_ROUNDS 1000000
+
+static double now_secs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Typical readings, varied a little every round so nothing is folded at compile time
+static void sample(plug_telemetry_t *t, long round) {
+    t->state = 1;
+    t->voltage = 230.5f + (round & 7) * 0.1f;
+    t->current = 0.512f;
+    t->power = 115.25f + (round & 3);
+    t->energy_uws = 4442400000000ULL + round;
+    t->sample_age_ms = 120 + (round & 255);
+}
+
+static size_t encode_json(const plug_telemetry_t *t, char *buf, size_t size) {
+    json_writer_t w;
+    json_writer_init(&w, buf, size, NULL, NULL);
+    plug_telemetry_write_json(&w, t);
+    return w.len;
+}
+
+int main(int argc, char *argv[]) {
+    long rounds = argc > 1 ? atol(argv[1]) : DEFAULT_ROUNDS;
+    plug_telemetry_t t;
+    char json[256];
+    uint8_t binary[PLUG_TELEMETRY_BINARY_SIZE];
+    volatile size_t sink = 0;
+
+    if (rounds <= 0) {
+        fprintf(stderr, "usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    sample(&t, 0);
+    size_t json_len = encode_json(&t, json, sizeof(json));
+    printf("Sample JSON      : %.*s\n", (int)json_len, json);
+
+    double start = now_secs();
+    for (long i = 0; i < rounds; i++) {
+        sample(&t, i);
+        sink += encode_json(&t, json, sizeof(json));
+    }
+    double json_secs = now_secs() - start;
+
+    start = now_secs();
+    for (long i = 0; i < rounds; i++) {
+        sample(&t, i);
+        plug_telemetry_encode(&t, binary);
+        sink += binary[16];
+    }
+    double binary_secs = now_secs() - start;
+
+    printf("Rounds           : %ld\n", rounds);
+    printf("JSON bytes       : %zu\n", json_len);
+    printf("Binary bytes     : %d\n", PLUG_TELEMETRY_BINARY_SIZE);
+    printf("JSON encode      : %.1f ns\n", json_secs * 1e9 / rounds);
+    printf("Binary encode    : %.1f ns\n", binary_secs * 1e9 / rounds);
+    printf("Speedup          : %.1fx\n", binary_secs > 0 ? json_secs / binary_secs : 0);
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "benchmark_energy.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+
+static const char *TAG = "benchmark_energy";
+
+// Running sums of the samples, written by the timer callback
+typedef struct {
+    uint32_t samples;
+    double sum;
+    float min;
+    float max;
+} power_samples_t;
+
+static esp_timer_handle_t sample_timer = NULL;
+static benchmark_energy_power_fn_t read_power;
+static benchmark_energy_counter_fn_t read_counter;
+static power_samples_t power_samples;
+static bool sampling = false;
+static bool has_counter;
+static uint64_t counter_start;
+static int64_t start_us;
+
+static void sample_timer_callback(void *arg) {
+    float watts;
+
+    if (read_power == NULL || !read_power(&watts)) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    if (power_samples.samples == 0 || watts < power_samples.min) {
+        power_samples.min = watts;
+    }
+    if (power_samples.samples == 0 || watts > power_samples.max) {
+        power_samples.max = watts;
+    }
+    power_samples.sum += watts;
+    power_samples.samples++;
+    taskEXIT_CRITICAL();
+}
+
+esp_err_t benchmark_energy_start(benchmark_energy_power_fn_t power, benchmark_energy_counter_fn_t counter) {
+    if (sampling) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (sample_timer == NULL) {
+        const esp_timer_create_args_t args = {
+            .callback = sample_timer_callback,
+            .name = "benchmark_energy",
+        };
+        esp_err_t ret = esp_timer_create(&args, &sample_timer);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    read_power = power;
+    read_counter = counter;
+    power_samples = (power_samples_t){0};
+    has_counter = counter != NULL && counter(&counter_start);
+    start_us = esp_timer_get_time();
+    // The first sample is one period in, so it covers a meter window of the run rather
+    // than the idle one before it
+    esp_err_t ret = esp_timer_start_periodic(sample_timer, BENCHMARK_ENERGY_SAMPLE_MS * 1000ULL);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    sampling = true;
+    return ESP_OK;
+}
+
+esp_err_t benchmark_energy_stop(float iterations_per_sec, benchmark_energy_t *energy) {
+    power_samples_t samples;
+    uint64_t counter_end;
+
+    if (!sampling) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_timer_stop(sample_timer);
+    sampling = false;
+    int64_t elapsed = esp_timer_get_time() - start_us;
+    bool counted = has_counter && read_counter(&counter_end) && elapsed > 0;
+    taskENTER_CRITICAL();
+    samples = power_samples;
+    taskEXIT_CRITICAL();
+
+    energy->samples = samples.samples;
+    energy->elapsed_secs = elapsed / 1e6f;
+    // The counter only advances at the end of each meter window, so this is accurate
+    // to one window
+    energy->energy = counted ? (counter_end - counter_start) / 1e6f : NAN;
+    energy->joules_per_kiloiteration = NAN;
+    energy->iterations_per_watt = NAN;
+    if (samples.samples > 0) {
+        energy->mean_power = samples.sum / samples.samples;
+        energy->min_power = samples.min;
+        energy->max_power = samples.max;
+    } else {
+        // A meter with only an energy counter still gives the mean
+        energy->mean_power = counted ? energy->energy / energy->elapsed_secs : NAN;
+        energy->min_power = NAN;
+        energy->max_power = NAN;
+    }
+    if (isnan(energy->mean_power)) {
+        ESP_LOGW(TAG, "No power reading during the run");
+        return ESP_OK;
+    }
+    if (iterations_per_sec > 0) {
+        energy->joules_per_kiloiteration = energy->mean_power * 1000 / iterations_per_sec;
+    }
+    if (energy->mean_power > 0) {
+        energy->iterations_per_watt = iterations_per_sec / energy->mean_power;
+    }
+    return ESP_OK;
+}
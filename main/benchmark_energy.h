@@ -0,0 +1,36 @@
+#ifndef BENCHMARK_ENERGY_H
+#define BENCHMARK_ENERGY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Power sampling period, one sample per HLW8012 window (HLW8012_DEFAULT_GATE_MS)
+#define BENCHMARK_ENERGY_SAMPLE_MS 1000
+
+// Power drawn during a run and the efficiency derived from its score
+typedef struct {
+    uint32_t samples;               // Power samples taken, 0 without a power meter
+    float mean_power;               // W, mean of the samples (energy over elapsed_secs without), NAN if unknown
+    float min_power;                // W, NAN without samples
+    float max_power;                // W, NAN without samples
+    float elapsed_secs;             // Between start and stop, calibration included
+    float energy;                   // J from the energy counter over elapsed_secs, NAN if unknown
+    float joules_per_kiloiteration; // mean_power over the score, NAN if unknown
+    float iterations_per_watt;      // Score over mean_power, i.e. iterations per joule, NAN if unknown
+} benchmark_energy_t;
+
+// Reads the instantaneous power (W) of the device, returns false when there is none
+typedef bool (*benchmark_energy_power_fn_t)(float *watts);
+// Reads the device energy counter (µWs), returns false when there is none
+typedef bool (*benchmark_energy_counter_fn_t)(uint64_t *energy_uws);
+
+// Start sampling power every BENCHMARK_ENERGY_SAMPLE_MS until benchmark_energy_stop. The
+// samples are taken from the esp_timer task, which only copies the last meter reading,
+// so the run being measured is barely disturbed. Either function may be NULL.
+esp_err_t benchmark_energy_start(benchmark_energy_power_fn_t power, benchmark_energy_counter_fn_t counter);
+
+// Stop sampling and fill energy, iterations_per_sec being the score of the sampled run
+esp_err_t benchmark_energy_stop(float iterations_per_sec, benchmark_energy_t *energy);
+
+#endif // BENCHMARK_ENERGY_H
@@ -0,0 +1,122 @@
+#include "benchmark_history.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+#define HISTORY_NAMESPACE "benchmark"
+#define HISTORY_KEY "history"
+#define BOOT_COUNT_KEY "boots"
+// Bump when benchmark_record_t changes so stale blobs are dropped
+#define HISTORY_VERSION 1
+
+static const char *TAG = "benchmark_history";
+
+// Layout persisted as a single NVS blob
+typedef struct {
+    uint8_t version;
+    uint8_t count;              // Valid records, up to BENCHMARK_HISTORY_SIZE
+    uint8_t next;               // Slot the next record goes to
+    uint8_t reserved;
+    benchmark_record_t records[BENCHMARK_HISTORY_SIZE];
+} history_blob_t;
+
+static history_blob_t history;
+static uint32_t boot_count = 0;
+static SemaphoreHandle_t history_mutex = NULL;
+
+esp_err_t benchmark_history_init(void) {
+    nvs_handle handle;
+    size_t size = sizeof(history);
+
+    if (history_mutex == NULL) {
+        history_mutex = xSemaphoreCreateMutex();
+        if (history_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    memset(&history, 0, sizeof(history));
+    history.version = HISTORY_VERSION;
+
+    esp_err_t err = nvs_open(HISTORY_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = nvs_get_blob(handle, HISTORY_KEY, &history, &size);
+    if (err != ESP_OK || size != sizeof(history) || history.version != HISTORY_VERSION ||
+        history.count > BENCHMARK_HISTORY_SIZE || history.next >= BENCHMARK_HISTORY_SIZE) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Discarding stored history (%s)", esp_err_to_name(err));
+        }
+        memset(&history, 0, sizeof(history));
+        history.version = HISTORY_VERSION;
+    }
+
+    size = sizeof(boot_count);
+    if (nvs_get_blob(handle, BOOT_COUNT_KEY, &boot_count, &size) != ESP_OK || size != sizeof(boot_count)) {
+        boot_count = 0;
+    }
+    boot_count++;
+    err = nvs_set_blob(handle, BOOT_COUNT_KEY, &boot_count, sizeof(boot_count));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+
+    ESP_LOGI(TAG, "Loaded %d runs, boot %u", history.count, (unsigned)boot_count);
+    return err;
+}
+
+uint32_t benchmark_history_boot_count(void) {
+    return boot_count;
+}
+
+esp_err_t benchmark_history_add(const benchmark_record_t *record) {
+    nvs_handle handle;
+
+    if (history_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+    history.records[history.next] = *record;
+    history.next = (history.next + 1) % BENCHMARK_HISTORY_SIZE;
+    if (history.count < BENCHMARK_HISTORY_SIZE) {
+        history.count++;
+    }
+
+    // One run every few seconds at most, so write the whole ring each time
+    esp_err_t err = nvs_open(HISTORY_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(handle, HISTORY_KEY, &history, sizeof(history));
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    xSemaphoreGive(history_mutex);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to persist history: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+int benchmark_history_get(benchmark_record_t *records, int max) {
+    int count = 0;
+
+    if (history_mutex == NULL) {
+        return 0;
+    }
+
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+    int first = (history.next + BENCHMARK_HISTORY_SIZE - history.count) % BENCHMARK_HISTORY_SIZE;
+    for (int i = 0; i < history.count && count < max; i++) {
+        records[count++] = history.records[(first + i) % BENCHMARK_HISTORY_SIZE];
+    }
+    xSemaphoreGive(history_mutex);
+    return count;
+}
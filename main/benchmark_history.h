@@ -0,0 +1,35 @@
+#ifndef BENCHMARK_HISTORY_H
+#define BENCHMARK_HISTORY_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+// Number of runs kept, the oldest one is overwritten
+#define BENCHMARK_HISTORY_SIZE 16
+
+// One finished benchmark run
+typedef struct {
+    int64_t timestamp;          // time() when the run finished (seconds since boot without SNTP)
+    uint32_t boot_count;        // Boot the run happened in, orders runs across reboots
+    float iterations_per_sec;   // CoreMark score
+    uint32_t iterations;
+    uint32_t free_heap;         // Free heap after the run (bytes)
+    uint16_t cpu_freq_mhz;
+    uint8_t plug_state;
+    uint8_t valid;              // 1 if the run is a valid CoreMark result
+    char firmware[12];
+} benchmark_record_t;
+
+// Load the ring from NVS and count this boot, nvs_flash_init must have been called
+esp_err_t benchmark_history_init(void);
+
+// Boot counter to stamp new records with
+uint32_t benchmark_history_boot_count(void);
+
+// Append a record and persist the ring to NVS
+esp_err_t benchmark_history_add(const benchmark_record_t *record);
+
+// Copy up to max records, oldest first. Returns the number copied.
+int benchmark_history_get(benchmark_record_t *records, int max);
+
+#endif // BENCHMARK_HISTORY_H
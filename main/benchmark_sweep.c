@@ -0,0 +1,115 @@
+#include "benchmark_sweep.h"
+#include "core_main.h"
+#include "esp_clk.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <math.h>
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+
+// Lets the clock settle before a run
+#define SWEEP_SETTLE_MS 100
+
+static const char *TAG = "benchmark_sweep";
+
+#if CONFIG_IDF_TARGET_ESP8266
+static const uint32_t supported_freqs[] = { 80, 160 };
+#else
+static const uint32_t supported_freqs[] = { 80, 160, 240 };
+#endif
+
+int benchmark_sweep_default_freqs(uint32_t *freqs, int max) {
+    int count = 0;
+
+    for (size_t i = 0; i < sizeof(supported_freqs) / sizeof(supported_freqs[0]) && count < max; i++) {
+        freqs[count++] = supported_freqs[i];
+    }
+    return count;
+}
+
+static esp_err_t set_cpu_freq(uint32_t mhz) {
+    if (esp_clk_cpu_freq() == mhz * 1000000) {
+        return ESP_OK;
+    }
+#if CONFIG_IDF_TARGET_ESP8266
+    if (mhz != 80 && mhz != 160) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    return esp_set_cpu_freq(mhz == 160 ? ESP_CPU_FREQ_160M : ESP_CPU_FREQ_80M);
+#elif CONFIG_PM_ENABLE
+    // Pinning min and max to the same clock keeps it constant during the run
+    esp_pm_config_esp32_t config = {
+        .max_freq_mhz = mhz,
+        .min_freq_mhz = mhz,
+        .light_sleep_enable = false,
+    };
+    return esp_pm_configure(&config);
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static void run_point(uint32_t mhz, benchmark_energy_power_fn_t power, benchmark_energy_counter_fn_t counter,
+                      benchmark_sweep_point_t *point) {
+    static coremark_result_t result;
+    benchmark_energy_t energy;
+
+    point->cpu_mhz = mhz;
+    point->mean_power = NAN;
+    point->energy_per_iteration = NAN;
+    point->err = set_cpu_freq(mhz);
+    if (point->err != ESP_OK) {
+        ESP_LOGW(TAG, "Cannot run at %u MHz: %s", (unsigned)mhz, esp_err_to_name(point->err));
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(SWEEP_SETTLE_MS));
+
+    bool measured = benchmark_energy_start(power, counter) == ESP_OK;
+    coremark_main(&result);
+    measured = measured && benchmark_energy_stop(result.iterations_per_sec, &energy) == ESP_OK;
+
+    point->iterations_per_sec = result.iterations_per_sec;
+    point->coremark_per_mhz = result.coremark_per_mhz;
+    point->iterations = result.iterations;
+    point->valid = result.valid;
+    if (measured) {
+        point->mean_power = energy.mean_power;
+        point->energy_per_iteration = energy.joules_per_kiloiteration * 1000;
+    }
+}
+
+static void print_table(const benchmark_sweep_point_t *points, int count) {
+    ee_printf("\n| Freq (MHz) | CoreMark | CoreMark/MHz | Power (W) | uJ/iteration | Flags |\n");
+    ee_printf("| :--------- | :------- | :----------- | :-------- | :----------- | :---- |\n");
+    for (int i = 0; i < count; i++) {
+        const benchmark_sweep_point_t *p = &points[i];
+        if (p->err != ESP_OK) {
+            ee_printf("| %-10u | n/a      | n/a          | n/a       | n/a          | %s |\n",
+                      (unsigned)p->cpu_mhz, COMPILER_FLAGS);
+            continue;
+        }
+        ee_printf("| %-10u | %-8.1f | %-12.3f | ", (unsigned)p->cpu_mhz, p->iterations_per_sec, p->coremark_per_mhz);
+        if (isnan(p->mean_power)) {
+            ee_printf("n/a       | n/a          ");
+        } else {
+            ee_printf("%-9.2f | %-12.1f ", p->mean_power, p->energy_per_iteration);
+        }
+        ee_printf("| %s%s |\n", COMPILER_FLAGS, p->valid ? "" : " (invalid)");
+    }
+}
+
+void benchmark_sweep_run(const uint32_t *freqs, int count, benchmark_energy_power_fn_t power,
+                         benchmark_energy_counter_fn_t counter, benchmark_sweep_point_t *points) {
+    uint32_t initial_mhz = esp_clk_cpu_freq() / 1000000;
+
+    for (int i = 0; i < count; i++) {
+        run_point(freqs[i], power, counter, &points[i]);
+    }
+    if (set_cpu_freq(initial_mhz) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to restore %u MHz", (unsigned)initial_mhz);
+    }
+    print_table(points, count);
+}
@@ -0,0 +1,33 @@
+#ifndef BENCHMARK_SWEEP_H
+#define BENCHMARK_SWEEP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "benchmark_energy.h"
+
+// Largest number of CPU clocks in one sweep
+#define BENCHMARK_SWEEP_MAX_POINTS 4
+
+// Outcome of the run at one clock
+typedef struct {
+    uint32_t cpu_mhz;           // Requested clock
+    esp_err_t err;              // ESP_ERR_NOT_SUPPORTED if the clock could not be set, no run then
+    float iterations_per_sec;
+    float coremark_per_mhz;     // Against the clock measured during the run
+    uint32_t iterations;
+    bool valid;                 // 1 if the run is a valid CoreMark result
+    float mean_power;           // W over the whole run, calibration included, NAN if unknown
+    float energy_per_iteration; // µJ, NAN if unknown
+} benchmark_sweep_point_t;
+
+// Clocks the target supports, in increasing order. Returns the number written.
+int benchmark_sweep_default_freqs(uint32_t *freqs, int max);
+
+// Run coremark_main at each clock of freqs and restore the initial clock. The power is
+// measured as in benchmark_energy.h, power and counter may be NULL. Prints the result
+// table over UART.
+void benchmark_sweep_run(const uint32_t *freqs, int count, benchmark_energy_power_fn_t power,
+                         benchmark_energy_counter_fn_t counter, benchmark_sweep_point_t *points);
+
+#endif // BENCHMARK_SWEEP_H
@@ -69,16 +69,27 @@ ee_s16 calc_func(ee_s16 *pdata, core_results *res) {
 		ee_s16 flag=data & 0x7; /* bits 0-2 is type of function to perform */
 		ee_s16 dtype=((data>>3) & 0xf); /* bits 3-6 is specific data for the operation */
 		dtype |= dtype << 4; /* replicate the lower 4 bits to get an 8b value */
+		/* the list drives the other algorithms, those left out of execs have no data block */
+		if ((flag==0 && !(res->execs & ID_STATE)) || (flag==1 && !(res->execs & ID_MATRIX)))
+			flag=-1;
 		switch (flag) {
 			case 0:
 				if (dtype<0x22) /* set min period for bit corruption */
 					dtype=0x22;
-				retval=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,dtype,res->crc);
+				{
+					PROFILE_START(t0);
+					retval=core_bench_state(res->size,res->memblock[3],res->seed1,res->seed2,dtype,res->crc);
+					PROFILE_ADD(res,KERNEL_STATE,t0);
+				}
 				if (res->crcstate==0)
 					res->crcstate=retval;
 				break;
 			case 1:
-				retval=core_bench_matrix(&(res->mat),dtype,res->crc);
+				{
+					PROFILE_START(t0);
+					retval=core_bench_matrix(&(res->mat),dtype,res->crc);
+					PROFILE_ADD(res,KERNEL_MATRIX,t0);
+				}
 				if (res->crcmatrix==0)
 					res->crcmatrix=retval;
 				break;
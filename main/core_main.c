@@ -19,10 +19,15 @@ Original Author: Shay Gal-on
 /* File: core_main.c
 	This file contains the framework to acquire a block of memory, seed initial parameters, tun t he benchmark and report the results.
 */
+#if defined(ESP_PLATFORM)
 #include "sdkconfig.h"
+#endif
 #include "coremark.h"
+#include "core_main.h"
+#if defined(ESP_PLATFORM)
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#endif
 
 /* Function: iterate
 	Run the benchmark for a specified number of iterations.
@@ -38,26 +43,197 @@ Original Author: Shay Gal-on
 static ee_u16 list_known_crc[]   =      {(ee_u16)0xd4b0,(ee_u16)0x3340,(ee_u16)0x6a79,(ee_u16)0xe714,(ee_u16)0xe3c1};
 static ee_u16 matrix_known_crc[] =      {(ee_u16)0xbe52,(ee_u16)0x1199,(ee_u16)0x5608,(ee_u16)0x1fd7,(ee_u16)0x0747};
 static ee_u16 state_known_crc[]  =      {(ee_u16)0x5e47,(ee_u16)0x39bf,(ee_u16)0xe5a4,(ee_u16)0x8e3a,(ee_u16)0x8d84};
+/* seedcrc, parameters and names of the runs above, by known_id */
+static ee_u16 known_seedcrc[]    =      {(ee_u16)0x8a02,(ee_u16)0x7b05,(ee_u16)0x4eaf,(ee_u16)0xe9f5,(ee_u16)0x18f2};
+static const coremark_params_t known_params[] = {
+	{6000,0x0,0x0,0x66,ALL_ALGORITHMS_MASK},		/* seed1=0, seed2=0, seed3=0x66, size 2000 per algorithm */
+	{6000,0x3415,0x3415,0x66,ALL_ALGORITHMS_MASK},	/* seed1=0x3415, seed2=0x3415, seed3=0x66, size 2000 per algorithm */
+	{1200,0x8,0x8,0x8,ALL_ALGORITHMS_MASK},			/* seed1=0x8, seed2=0x8, seed3=0x8, size 400 per algorithm */
+	{2000,0x0,0x0,0x66,ALL_ALGORITHMS_MASK},		/* seed1=0, seed2=0, seed3=0x66, size 666 per algorithm */
+	{2000,0x3415,0x3415,0x66,ALL_ALGORITHMS_MASK}	/* seed1=0x3415, seed2=0x3415, seed3=0x66, size 666 per algorithm */
+};
+static const char *known_name[]  =      {"6k-performance","6k-validation","profile","2k-performance","2k-validation"};
+static const char *known_desc[]  =      {"6k performance","6k validation","Profile generation","2K performance","2K validation"};
+#define NUM_KNOWN (sizeof(known_seedcrc)/sizeof(known_seedcrc[0]))
 void *iterate(void *pres) {
+	core_results *res=(core_results *)pres;
+	iterate_chunk(res,0,res->iterations);
+	return NULL;
+}
+
+/* Function: iterate_chunk
+	Run iterations [first, first+count) of a run. The crc is only reset when first is 0,
+	so a run split into consecutive chunks gives the same results as a single <iterate>.
+*/
+void iterate_chunk(core_results *res, ee_u32 first, ee_u32 count) {
 	ee_u32 i;
 	ee_u16 crc;
-	core_results *res=(core_results *)pres;
-	ee_u32 iterations=res->iterations;
-	res->crc=0;
-	res->crclist=0;
-	res->crcmatrix=0;
-	res->crcstate=0;
+	if (first==0) {
+		res->crc=0;
+		res->crclist=0;
+		res->crcmatrix=0;
+		res->crcstate=0;
+#if CORE_PROFILE
+		for (i=0; i<NUM_ALGORITHMS; i++)
+			res->kernel_cycles[i]=0;
+#endif
+	}
 
-	for (i=0; i<iterations; i++) {
+	for (i=first; i<first+count; i++) {
+		PROFILE_START(t0);
 		crc=core_bench_list(res,1);
 		res->crc=crcu16(crc,res->crc);
 		crc=core_bench_list(res,-1);
 		res->crc=crcu16(crc,res->crc);
+		PROFILE_ADD(res,KERNEL_LIST,t0);
 		if (i==0) res->crclist=res->crc;
 	}
-	return NULL;
 }
 
+static coremark_progress_cb_t progress_cb=NULL;
+static void *progress_arg=NULL;
+
+void coremark_set_progress_cb(coremark_progress_cb_t cb, void *arg) {
+	progress_cb=cb;
+	progress_arg=arg;
+}
+
+/* Function: iterate_chunked
+	Run res->iterations in chunks of <CHUNK_ITERATIONS>, calling <portable_yield> between
+	chunks to keep the watchdog fed. Only the time spent inside the chunks is accumulated.
+	The progress callback, if any, is called after each chunk, outside of the timed part.
+
+	Returns:
+	Compute ticks, excluding the time spent yielding.
+*/
+CORE_TICKS iterate_chunked(core_results *res) {
+	ee_u32 done,count,chunk=0;
+	CORE_TICKS chunk_start,chunk_ticks,compute=0;
+	for (done=0; done<res->iterations; done+=count) {
+		count=res->iterations-done;
+		if (count>CHUNK_ITERATIONS)
+			count=CHUNK_ITERATIONS;
+		chunk_start=portable_ticks();
+		iterate_chunk(res,done,count);
+		chunk_ticks=portable_ticks()-chunk_start;
+		compute+=chunk_ticks;
+		if (progress_cb) {
+			coremark_progress_t progress;
+			secs_ret chunk_secs=time_in_secs(chunk_ticks);
+#if (MULTITHREAD>1)
+			progress.context=res->port.context;
+#else
+			progress.context=0;
+#endif
+			progress.chunk=chunk;
+			progress.iterations=count;
+			progress.done=done+count;
+			progress.total=res->iterations;
+			progress.ticks=chunk_ticks;
+			progress.elapsed=compute;
+			progress.iterations_per_sec=(chunk_secs > 0) ? count/chunk_secs : 0;
+			progress_cb(&progress,progress_arg);
+		}
+		chunk++;
+		portable_yield();
+	}
+	return compute;
+}
+
+#if HAS_FLOAT
+/* Configuration: CALIBRATION_PROBES
+	Number of timed probe batches, of 1x..Nx the base batch size, fitted by <calibrate_iterations>.
+*/
+#ifndef CALIBRATION_PROBES
+#define CALIBRATION_PROBES 4
+#endif
+/* Configuration: CALIBRATION_MIN_PROBE_SECS
+	Minimum duration of the base probe batch, keeps timer resolution out of the fit.
+*/
+#ifndef CALIBRATION_MIN_PROBE_SECS
+#define CALIBRATION_MIN_PROBE_SECS 0.05
+#endif
+
+/* Time count iterations on each of the <default_num_contexts> contexts of res, in parallel
+	as in the timed run so the cost of sharing the cores is part of the fit. Like the score,
+	this is the compute time of the slowest context. */
+static CORE_TICKS time_probe(core_results *res, ee_u32 count) {
+	CORE_TICKS t0;
+#if (MULTITHREAD>1)
+	ee_u32 i;
+	for (i=0 ; i<default_num_contexts; i++) {
+		res[i].iterations=count;
+		res[i].execs=res[0].execs;
+		core_start_parallel(&res[i]);
+	}
+	t0=0;
+	for (i=0 ; i<default_num_contexts; i++) {
+		core_stop_parallel(&res[i]);
+		if (res[i].port.ticks>t0)
+			t0=res[i].port.ticks;
+	}
+#else
+	t0=portable_ticks();
+	iterate_chunk(res,0,count);
+	t0=portable_ticks()-t0;
+#endif
+	portable_yield();
+	return t0;
+}
+
+/* Function: calibrate_iterations
+	Pick the number of iterations that runs for about target_secs.
+
+	The base batch size is doubled until one batch takes at least <CALIBRATION_MIN_PROBE_SECS>.
+	Batches of 1x..<CALIBRATION_PROBES>x that size are then timed, and a least squares fit of
+	time=overhead+n*cost gives the per-iteration cost the iteration count is derived from.
+	res is the array of contexts, every probe runs all the contexts of the timed run.
+*/
+static ee_u32 calibrate_iterations(core_results *res, secs_ret target_secs, core_calibration *cal) {
+	ee_u32 base=1,k,n;
+	secs_ret secs,cost,min_cost=0,max_cost=0;
+	secs_ret sum_n=0,sum_t=0,sum_nn=0,sum_nt=0,denom,iterations;
+
+	cal->probes=0;
+	cal->probe_iterations=0;
+	cal->probe_ticks=0;
+	cal->target_secs=target_secs;
+	for (;;) {
+		CORE_TICKS ticks=time_probe(res,base);
+		cal->probe_iterations+=base;
+		cal->probe_ticks+=ticks;
+		if (time_in_secs(ticks) >= (secs_ret)CALIBRATION_MIN_PROBE_SECS || base >= 0x10000000)
+			break;
+		base*=2;
+	}
+	for (k=1; k<=CALIBRATION_PROBES; k++) {
+		CORE_TICKS ticks;
+		n=base*k;
+		ticks=time_probe(res,n);
+		secs=time_in_secs(ticks);
+		cost=secs/n;
+		if (k==1 || cost<min_cost) min_cost=cost;
+		if (k==1 || cost>max_cost) max_cost=cost;
+		sum_n+=n;
+		sum_t+=secs;
+		sum_nn+=(secs_ret)n*n;
+		sum_nt+=n*secs;
+		cal->probes++;
+		cal->probe_iterations+=n;
+		cal->probe_ticks+=ticks;
+	}
+	denom=CALIBRATION_PROBES*sum_nn-sum_n*sum_n;
+	cal->secs_per_iteration=(denom>0) ? (CALIBRATION_PROBES*sum_nt-sum_n*sum_t)/denom : 0;
+	if (cal->secs_per_iteration<=0) /* fit is meaningless, fall back to the mean cost */
+		cal->secs_per_iteration=sum_t/sum_n;
+	cal->overhead_secs=(sum_t-cal->secs_per_iteration*sum_n)/CALIBRATION_PROBES;
+	cal->spread=(max_cost-min_cost)/(sum_t/sum_n);
+	iterations=(target_secs-(cal->overhead_secs>0 ? cal->overhead_secs : 0))/cal->secs_per_iteration;
+	cal->iterations=(iterations<1) ? 1 : (iterations>(secs_ret)0xffffffffu) ? 0xffffffffu : (ee_u32)(iterations+0.5);
+	return cal->iterations;
+}
+#endif
+
 #if (SEED_METHOD==SEED_ARG)
 ee_s32 get_seed_args(int i, int argc, char *argv[]);
 #define get_seed(x) (ee_s16)get_seed_args(x,argc,argv)
@@ -70,7 +246,131 @@ ee_s32 get_seed_32(int i);
 #if (MEM_METHOD==MEM_STATIC)
 ee_u8 static_memblk[TOTAL_DATA_SIZE];
 #endif
-char *mem_name[3] = {"Static","Heap","Stack"};
+char *mem_name[4] = {"Static","Heap","Stack","Arena"};
+
+/* Function: seed_crc
+	Function of the seeds and the size per algorithm that identifies a known run.
+*/
+static ee_u16 seed_crc(ee_s16 seed1, ee_s16 seed2, ee_s16 seed3, ee_u32 size) {
+	ee_u16 seedcrc=0;
+	seedcrc=crc16(seed1,seedcrc);
+	seedcrc=crc16(seed2,seedcrc);
+	seedcrc=crc16(seed3,seedcrc);
+	seedcrc=crc16(size,seedcrc);
+	return seedcrc;
+}
+
+static ee_s16 seedcrc_known_id(ee_u16 seedcrc) {
+	ee_u16 i;
+	for (i=0; i<NUM_KNOWN; i++) {
+		if (known_seedcrc[i]==seedcrc)
+			return i;
+	}
+	return -1;
+}
+
+static ee_u32 count_algorithms(ee_u32 execs) {
+	ee_u32 i,n=0;
+	for (i=0; i<NUM_ALGORITHMS; i++) {
+		if ((1<<i) & execs)
+			n++;
+	}
+	return n;
+}
+
+/* Function: coremark_default_params
+	Parameters of the build: seeds 1 to 3 and 5 (execs) and <TOTAL_DATA_SIZE>.
+*/
+void coremark_default_params(coremark_params_t *params) {
+	int argc=0;
+	char *argv[1] = {NULL};
+	(void)argc; (void)argv;
+	params->seed1=get_seed(1);
+	params->seed2=get_seed(2);
+	params->seed3=get_seed(3);
+	params->execs=get_seed_32(5);
+	if (params->execs==0) { /* if not supplied, execute all algorithms */
+		params->execs=ALL_ALGORITHMS_MASK;
+	}
+		/* put in some default values based on one seed only for easy testing */
+	if ((params->seed1==0) && (params->seed2==0) && (params->seed3==0)) { /* validation run */
+		params->seed1=0;
+		params->seed2=0;
+		params->seed3=0x66;
+	}
+	if ((params->seed1==1) && (params->seed2==0) && (params->seed3==0)) { /* perfromance run */
+		params->seed1=0x3415;
+		params->seed2=0x3415;
+		params->seed3=0x66;
+	}
+	params->size=TOTAL_DATA_SIZE;
+#if (MEM_METHOD==MEM_MALLOC)
+	{
+		ee_s32 malloc_override=get_seed(7);
+		if (malloc_override != 0) 
+			params->size=malloc_override;
+	}
+#endif
+}
+
+ee_s16 coremark_find_profile(const char *name, coremark_params_t *params) {
+	ee_u16 i;
+	for (i=0; i<NUM_KNOWN; i++) {
+		const char *a=known_name[i],*b=name;
+		while (*a!='\0' && *a==*b) {
+			a++;
+			b++;
+		}
+		if (*a=='\0' && *b=='\0') {
+			*params=known_params[i];
+			return i;
+		}
+	}
+	return -1;
+}
+
+const char *coremark_params_error(const coremark_params_t *params) {
+	if (params->size<MIN_DATA_SIZE || params->size>MAX_DATA_SIZE)
+		return "size out of range";
+	if ((params->execs & ~ALL_ALGORITHMS_MASK) || !(params->execs & ID_LIST))
+		return "algorithms must be a mask of list (1), matrix (2) and state (4) with list";
+	return NULL;
+}
+
+/* Function: coremark_params_known_id
+	Only runs of all the algorithms can be validated, the list crc depends on the results of
+	matrix and state.
+*/
+ee_s16 coremark_params_known_id(const coremark_params_t *params) {
+	if (params->execs!=ALL_ALGORITHMS_MASK)
+		return -1;
+	return seedcrc_known_id(seed_crc(params->seed1,params->seed2,params->seed3,params->size/NUM_ALGORITHMS));
+}
+
+const char *coremark_profile_name(ee_s16 known_id) {
+	return (known_id>=0 && known_id<(ee_s16)NUM_KNOWN) ? known_name[known_id] : NULL;
+}
+
+static coremark_params_t run_params;
+static ee_u8 run_params_set=0;
+
+int coremark_set_params(const coremark_params_t *params) {
+	coremark_params_t defaults;
+	if (params==NULL) {
+		run_params_set=0;
+		coremark_default_params(&defaults);
+		params=&defaults;
+	} else {
+		run_params=*params;
+		run_params_set=1;
+	}
+#if (MEM_METHOD==MEM_ARENA)
+	if (portable_arena((ee_size_t)params->size*MULTITHREAD)==NULL)
+		return -1;
+#endif
+	return 0;
+}
+
 /* Function: main
 	Main entry routine for the benchmark.
 	This function is responsible for the following steps:
@@ -84,20 +384,28 @@ char *mem_name[3] = {"Static","Heap","Stack"};
 	1 - first seed  : Any value
 	2 - second seed : Must be identical to first for iterations to be identical
 	3 - third seed  : Any value, should be at least an order of magnitude less then the input size, but bigger then 32.
-	4 - Iterations  : Special, if set to 0, iterations will be automatically determined such that the benchmark will run between 10 to 100 secs
+	4 - Iterations  : Special, if set to 0, iterations will be calibrated such that the benchmark will run for about <CALIBRATION_SECS>
 
+	When result is not NULL it receives the figures printed in the report.
 */
 
-MAIN_RETURN_TYPE coremark_main(void) {
+MAIN_RETURN_TYPE coremark_main(coremark_result_t *result) {
 	int argc=0;
 	char *argv[1] = {NULL};
 	ee_u16 i,j=0,num_algorithms=0;
 	ee_s16 known_id=-1,total_errors=0;
 	ee_u16 seedcrc=0;
-	CORE_TICKS total_time;
+	coremark_params_t params;
+	CORE_TICKS total_time,wall_time;
+	core_calibration calibration;
 	core_results results[MULTITHREAD];
+#if CORE_PROFILE
+	CORE_TICKS kernel_cycles[NUM_ALGORITHMS];
+#endif
 #if (MEM_METHOD==MEM_STACK)
 	ee_u8 stack_memblock[TOTAL_DATA_SIZE*MULTITHREAD];
+#elif (MEM_METHOD==MEM_ARENA)
+	ee_u8 *arena_memblock;
 #endif
 	/* first call any initializations needed */
 	portable_init(&(results[0].port), &argc, argv);
@@ -106,42 +414,31 @@ MAIN_RETURN_TYPE coremark_main(void) {
 		ee_printf("list_head structure too big for comparable data!\n");
 		return MAIN_RETURN_VAL;
 	}
-	results[0].seed1=get_seed(1);
-	results[0].seed2=get_seed(2);
-	results[0].seed3=get_seed(3);
+	/* seeds and size from <coremark_set_params>, else from the build */
+	if (run_params_set)
+		params=run_params;
+	else
+		coremark_default_params(&params);
+	if (params.size>MAX_DATA_SIZE)
+		params.size=MAX_DATA_SIZE;
+	results[0].seed1=params.seed1;
+	results[0].seed2=params.seed2;
+	results[0].seed3=params.seed3;
 	results[0].iterations=get_seed_32(4);
 #if CORE_DEBUG
 	results[0].iterations=1;
 #endif
-	results[0].execs=get_seed_32(5);
-	if (results[0].execs==0) { /* if not supplied, execute all algorithms */
-		results[0].execs=ALL_ALGORITHMS_MASK;
-	}
-		/* put in some default values based on one seed only for easy testing */
-	if ((results[0].seed1==0) && (results[0].seed2==0) && (results[0].seed3==0)) { /* validation run */
-		results[0].seed1=0;
-		results[0].seed2=0;
-		results[0].seed3=0x66;
-	}
-	if ((results[0].seed1==1) && (results[0].seed2==0) && (results[0].seed3==0)) { /* perfromance run */
-		results[0].seed1=0x3415;
-		results[0].seed2=0x3415;
-		results[0].seed3=0x66;
-	}
+	results[0].execs=params.execs;
 #if (MEM_METHOD==MEM_STATIC)
 	results[0].memblock[0]=(void *)static_memblk;
-	results[0].size=TOTAL_DATA_SIZE;
+	results[0].size=params.size;
 	results[0].err=0;
 	#if (MULTITHREAD>1)
 	#error "Cannot use a static data area with multiple contexts!"
 	#endif
 #elif (MEM_METHOD==MEM_MALLOC)
 	for (i=0 ; i<MULTITHREAD; i++) {
-		ee_s32 malloc_override=get_seed(7);
-		if (malloc_override != 0) 
-			results[i].size=malloc_override;
-		else
-			results[i].size=TOTAL_DATA_SIZE;
+		results[i].size=params.size;
 		results[i].memblock[0]=portable_malloc(results[i].size);
 		results[i].seed1=results[0].seed1;
 		results[i].seed2=results[0].seed2;
@@ -152,7 +449,29 @@ MAIN_RETURN_TYPE coremark_main(void) {
 #elif (MEM_METHOD==MEM_STACK)
 	for (i=0 ; i<MULTITHREAD; i++) {
 		results[i].memblock[0]=stack_memblock+i*TOTAL_DATA_SIZE;
-		results[i].size=TOTAL_DATA_SIZE;
+		results[i].size=params.size;
+		results[i].seed1=results[0].seed1;
+		results[i].seed2=results[0].seed2;
+		results[i].seed3=results[0].seed3;
+		results[i].err=0;
+		results[i].execs=results[0].execs;
+	}
+#elif (MEM_METHOD==MEM_ARENA)
+	arena_memblock=portable_arena((ee_size_t)params.size*MULTITHREAD);
+	if (arena_memblock==NULL) {
+		ee_printf("ERROR! Cannot allocate %lu bytes of data!\n",(long unsigned)params.size*MULTITHREAD);
+		if (result) {
+			result->iterations=0;
+			result->iterations_per_sec=0;
+			result->errors=1;
+			result->valid=0;
+		}
+		portable_fini(&(results[0].port));
+		return MAIN_RETURN_VAL;
+	}
+	for (i=0 ; i<MULTITHREAD; i++) {
+		results[i].memblock[0]=arena_memblock+i*params.size;
+		results[i].size=params.size;
 		results[i].seed1=results[0].seed1;
 		results[i].seed2=results[0].seed2;
 		results[i].seed3=results[0].seed3;
@@ -164,10 +483,7 @@ MAIN_RETURN_TYPE coremark_main(void) {
 #endif
 	/* Data init */ 
 	/* Find out how space much we have based on number of algorithms */
-	for (i=0; i<NUM_ALGORITHMS; i++) {
-		if ((1<<(ee_u32)i) & results[0].execs)
-			num_algorithms++;
-	}
+	num_algorithms=count_algorithms(results[0].execs);
 	for (i=0 ; i<MULTITHREAD; i++) 
 		results[i].size=results[i].size/num_algorithms;
 	/* Assign pointers */
@@ -193,7 +509,11 @@ MAIN_RETURN_TYPE coremark_main(void) {
 	}
 	
 	/* automatically determine number of iterations if not set */
+	calibration.iterations=0;
 	if (results[0].iterations==0) { 
+#if HAS_FLOAT
+		results[0].iterations=calibrate_iterations(&results[0],(secs_ret)CALIBRATION_SECS,&calibration);
+#else
 		secs_ret secs_passed=0;
 		ee_u32 divisor;
 		results[0].iterations=1;
@@ -209,6 +529,7 @@ MAIN_RETURN_TYPE coremark_main(void) {
 		if (divisor==0) /* some machines cast float to int as 0 since this conversion is not defined by ANSI, but we know at least one second passed */
 			divisor=1;
 		results[0].iterations*=1+10/divisor;
+#endif
 	}
 	/* perform actual benchmark */
 	start_time();
@@ -225,60 +546,29 @@ MAIN_RETURN_TYPE coremark_main(void) {
 		core_stop_parallel(&results[i]);
 	}
 #else
-	// Break up iteration into larger chunks with less frequent yields
-	int total_iterations = results[0].iterations;
-	int chunk_size = 5000; // Larger chunks for better performance
-	
-	for (int chunk = 0; chunk < total_iterations; chunk += chunk_size) {
-		int current_chunk = (total_iterations - chunk) > chunk_size ? chunk_size : (total_iterations - chunk);
-		results[0].iterations = current_chunk;
-		iterate(&results[0]);
-		
-		// Quick yield to prevent watchdog
-		vTaskDelay(1);
-		
-		// Less frequent longer yields
-		if ((chunk % (chunk_size * 20)) == 0) {
-			vTaskDelay(pdMS_TO_TICKS(5));
-		}
-	}
-	
-	// Restore total iterations for reporting
-	results[0].iterations = total_iterations;
+	total_time=iterate_chunked(&results[0]);
 #endif
 	stop_time();
-	total_time=get_time();
+	wall_time=get_time();
+#if (MULTITHREAD>1)
+	/* Score from the compute time of the slowest context, thread creation and joining
+		are only part of the wall time */
+	total_time=0;
+	for (i=0 ; i<default_num_contexts; i++) {
+		if (results[i].port.ticks>total_time)
+			total_time=results[i].port.ticks;
+	}
+#endif
 	/* get a function of the input to report */
-	seedcrc=crc16(results[0].seed1,seedcrc);
-	seedcrc=crc16(results[0].seed2,seedcrc);
-	seedcrc=crc16(results[0].seed3,seedcrc);
-	seedcrc=crc16(results[0].size,seedcrc);
+	seedcrc=seed_crc(results[0].seed1,results[0].seed2,results[0].seed3,results[0].size);
 	
-	switch (seedcrc) { /* test known output for common seeds */
-		case 0x8a02: /* seed1=0, seed2=0, seed3=0x66, size 2000 per algorithm */
-			known_id=0;
-			ee_printf("6k performance run parameters for coremark.\n");
-			break;
-		case 0x7b05: /*  seed1=0x3415, seed2=0x3415, seed3=0x66, size 2000 per algorithm */
-			known_id=1;
-			ee_printf("6k validation run parameters for coremark.\n");
-			break;
-		case 0x4eaf: /* seed1=0x8, seed2=0x8, seed3=0x8, size 400 per algorithm */
-			known_id=2;
-			ee_printf("Profile generation run parameters for coremark.\n");
-			break;
-		case 0xe9f5: /* seed1=0, seed2=0, seed3=0x66, size 666 per algorithm */
-			known_id=3;
-			ee_printf("2K performance run parameters for coremark.\n");
-			break;
-		case 0x18f2: /*  seed1=0x3415, seed2=0x3415, seed3=0x66, size 666 per algorithm */
-			known_id=4;
-			ee_printf("2K validation run parameters for coremark.\n");
-			break;
-		default:
-			total_errors=-1;
-			break;
-	}
+	/* test known output for common seeds, the list crc of a partial run is not known */
+	if (results[0].execs==ALL_ALGORITHMS_MASK)
+		known_id=seedcrc_known_id(seedcrc);
+	if (known_id>=0)
+		ee_printf("%s run parameters for coremark.\n",known_desc[known_id]);
+	else
+		total_errors=-1;
 	if (known_id>=0) {
 		for (i=0 ; i<default_num_contexts; i++) {
 			results[i].err=0;
@@ -306,12 +596,22 @@ MAIN_RETURN_TYPE coremark_main(void) {
 	ee_printf("Size          : %lu\n", (long unsigned) results[0].size);
 	ee_printf("Ticks        : %lu\n", (long unsigned) total_time);
 	secs_ret total_secs = time_in_secs(total_time);
+	secs_ret cpu_mhz = portable_cpu_mhz();
 #if HAS_FLOAT
 	ee_printf("Time         : %.2f sec\n", (double)total_secs);
+	ee_printf("Wall time    : %.2f sec\n", (double)time_in_secs(wall_time));
 	if (total_secs > 0)
 		ee_printf("Iterations/Sec          : %.2f\n", (double)(default_num_contexts*results[0].iterations)/total_secs);
+#if (MULTITHREAD>1)
+	for (i=0 ; i<default_num_contexts; i++) {
+		secs_ret ctx_secs=time_in_secs(results[i].port.ticks);
+		if (ctx_secs > 0)
+			ee_printf("[%d]Iterations/Sec       : %.2f\n", i, (double)results[i].iterations/ctx_secs);
+	}
+#endif
 #else 
 	ee_printf("Time         : %d sec\n", total_secs);
+	ee_printf("Wall time    : %d sec\n", time_in_secs(wall_time));
 	if (total_secs > 0)
 		ee_printf("Iterations/Sec: %d\n", default_num_contexts*results[0].iterations/total_secs);
 #endif
@@ -320,6 +620,12 @@ MAIN_RETURN_TYPE coremark_main(void) {
 		total_errors++;
 	}
 
+	ee_printf("Timer            : %s\n",portable_timer_name());
+#if HAS_FLOAT
+	if (cpu_mhz > 0 && total_secs > 0)
+		ee_printf("CoreMark/MHz     : %.3f at %.0f MHz\n",(double)(default_num_contexts*results[0].iterations)/total_secs/cpu_mhz,(double)cpu_mhz);
+#endif
+
 	ee_printf("Iterations       : %lu\n", (long unsigned) default_num_contexts*results[0].iterations);
 	ee_printf("Compiler version : %s\n",COMPILER_VERSION);
 	ee_printf("Compiler flags   : %s\n",COMPILER_FLAGS);
@@ -327,6 +633,33 @@ MAIN_RETURN_TYPE coremark_main(void) {
 	ee_printf("Parallel %s : %d\n",PARALLEL_METHOD,default_num_contexts);
 #endif
 	ee_printf("Memory location  : %s\n",MEM_LOCATION);
+#if HAS_FLOAT
+	if (calibration.iterations>0) {
+		ee_printf("Calibration      : %lu iterations for %.1f sec\n",(long unsigned)calibration.iterations,(double)calibration.target_secs);
+		ee_printf("Calibration probe: %lu batches, %lu iterations, %.3f sec\n",(long unsigned)calibration.probes,
+			(long unsigned)calibration.probe_iterations,(double)time_in_secs(calibration.probe_ticks));
+		ee_printf("Calibration fit  : %.3f us/iteration, %.3f us overhead, spread %.1f%%\n",calibration.secs_per_iteration*1e6,
+			calibration.overhead_secs*1e6,calibration.spread*100);
+	}
+#endif
+#if CORE_PROFILE
+	/* list calls matrix and state, keep only its own share */
+	for (j=0 ; j<NUM_ALGORITHMS; j++) {
+		kernel_cycles[j]=0;
+		for (i=0 ; i<default_num_contexts; i++)
+			kernel_cycles[j]+=results[i].kernel_cycles[j];
+	}
+	kernel_cycles[KERNEL_LIST]-=kernel_cycles[KERNEL_MATRIX]+kernel_cycles[KERNEL_STATE];
+	{
+		CORE_TICKS all=kernel_cycles[KERNEL_LIST]+kernel_cycles[KERNEL_MATRIX]+kernel_cycles[KERNEL_STATE];
+		static const char *kernel_name[NUM_ALGORITHMS]={"list  ","matrix","state "};
+		for (j=0 ; j<NUM_ALGORITHMS; j++) {
+			ee_printf("Kernel %s    : %llu cycles, %.1f per iteration, %.1f%%\n",kernel_name[j],
+				(unsigned long long)kernel_cycles[j],(double)kernel_cycles[j]/(default_num_contexts*results[0].iterations),
+				all>0 ? 100.0*kernel_cycles[j]/all : 0);
+		}
+	}
+#endif
 	/* output for verification */
 	ee_printf("seedcrc          : 0x%04x\n",seedcrc);
 	if (results[0].execs & ID_LIST)
@@ -356,6 +689,44 @@ MAIN_RETURN_TYPE coremark_main(void) {
 #endif
 			ee_printf("\n");
 		}
+#endif
+	}
+	if (result) {
+		result->contexts=default_num_contexts;
+		result->iterations=default_num_contexts*results[0].iterations;
+		result->size=results[0].size;
+		result->data_size=params.size;
+		result->seed1=results[0].seed1;
+		result->seed2=results[0].seed2;
+		result->seed3=results[0].seed3;
+		result->execs=results[0].execs;
+		result->ticks=total_time;
+		result->wall_ticks=wall_time;
+		result->total_secs=total_secs;
+		result->wall_secs=time_in_secs(wall_time);
+		result->iterations_per_sec=(total_secs > 0) ? (secs_ret)result->iterations/total_secs : 0;
+		result->cpu_mhz=cpu_mhz;
+		result->coremark_per_mhz=(cpu_mhz > 0) ? result->iterations_per_sec/cpu_mhz : 0;
+		result->timer=portable_timer_name();
+		result->seedcrc=seedcrc;
+		result->known_id=known_id;
+		result->profile=coremark_profile_name(known_id);
+		for (i=0 ; i<MULTITHREAD; i++) {
+			int ran=(i<default_num_contexts);
+			result->crclist[i]=ran ? results[i].crclist : 0;
+			result->crcmatrix[i]=ran ? results[i].crcmatrix : 0;
+			result->crcstate[i]=ran ? results[i].crcstate : 0;
+			result->crcfinal[i]=ran ? results[i].crc : 0;
+#if (MULTITHREAD>1)
+			result->context_ticks[i]=ran ? results[i].port.ticks : 0;
+#endif
+		}
+		result->errors=total_errors;
+		result->valid=(total_errors==0 && known_id>=0);
+		result->calibration=calibration;
+#if CORE_PROFILE
+		for (j=0 ; j<NUM_ALGORITHMS; j++)
+			result->kernel_cycles[j]=kernel_cycles[j];
 #endif
 	}
 	if (total_errors>0)
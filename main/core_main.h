@@ -3,6 +3,93 @@
 
 #include "coremark.h"
 
-MAIN_RETURN_TYPE coremark_main(void);
+// Outcome of one coremark_main run, for callers that need more than the UART log
+typedef struct {
+    ee_u32 contexts;                    // Number of contexts that ran
+    ee_u32 iterations;                  // Iterations summed over all contexts
+    ee_u32 size;                        // Data size per algorithm
+    ee_u32 data_size;                   // Data size per context, all algorithms
+    ee_s16 seed1;                       // Seeds the data was initialized from
+    ee_s16 seed2;
+    ee_s16 seed3;
+    ee_u32 execs;                       // Algorithms that ran, ID_* mask
+    CORE_TICKS ticks;                   // Ticks the score is computed from, the slowest context's with several
+    CORE_TICKS wall_ticks;              // Ticks between start_time and stop_time
+    secs_ret total_secs;                // ticks in seconds
+    secs_ret wall_secs;                 // wall_ticks in seconds
+    secs_ret iterations_per_sec;        // The score, 0 if no time elapsed
+    secs_ret cpu_mhz;                   // Clock during the run, 0 if unknown
+    secs_ret coremark_per_mhz;          // iterations_per_sec / cpu_mhz, 0 if unknown
+    const char *timer;                  // Timer backend the ticks come from
+    ee_u16 seedcrc;                     // Identifies the seeds and size
+    ee_s16 known_id;                    // Index in the known crc tables, -1 if unknown
+    const char *profile;                // Name of the known_id profile, NULL if unknown
+    ee_u16 crclist[MULTITHREAD];        // Per-context crcs
+    ee_u16 crcmatrix[MULTITHREAD];
+    ee_u16 crcstate[MULTITHREAD];
+    ee_u16 crcfinal[MULTITHREAD];
+#if (MULTITHREAD>1)
+    CORE_TICKS context_ticks[MULTITHREAD];  // Time spent by each context
+#endif
+    ee_s16 errors;                      // Total errors, -1 if the seeds cannot be validated
+    ee_u8 valid;                        // 1 if the run is a valid CoreMark result
+    core_calibration calibration;       // Iterations calibration, calibration.iterations is 0 if not used
+#if CORE_PROFILE
+    CORE_TICKS kernel_cycles[NUM_ALGORITHMS];   // Cycles per KERNEL_*, summed over contexts, list without
+                                                // the matrix and state calls it makes
+#endif
+} coremark_result_t;
+
+// Progress of a run, reported after every chunk of CHUNK_ITERATIONS
+typedef struct {
+    ee_u32 context;                     // Context that ran the chunk
+    ee_u32 chunk;                       // Index of the chunk within the context
+    ee_u32 iterations;                  // Iterations in this chunk
+    ee_u32 done;                        // Iterations done so far by the context
+    ee_u32 total;                       // Iterations the context will run
+    CORE_TICKS ticks;                   // Compute ticks of this chunk
+    CORE_TICKS elapsed;                 // Compute ticks so far in the context
+    secs_ret iterations_per_sec;        // Instantaneous rate over this chunk
+} coremark_progress_t;
+
+// Called from the benchmark task(s) outside of the timed compute, must not block for long
+typedef void (*coremark_progress_cb_t)(const coremark_progress_t *progress, void *arg);
+
+// Install the progress callback, NULL to disable it
+void coremark_set_progress_cb(coremark_progress_cb_t cb, void *arg);
+
+// Data size, seeds and algorithms of a run. The known profiles (see coremark_find_profile)
+// are the ones whose crcs can be validated.
+typedef struct {
+    ee_u32 size;                        // Data size per context, split between the algorithms
+    ee_s16 seed1;
+    ee_s16 seed2;
+    ee_s16 seed3;
+    ee_u32 execs;                       // ID_* mask, ID_LIST drives the others so it is required
+} coremark_params_t;
+
+// Parameters of the build (seeds of core_portme.c and TOTAL_DATA_SIZE)
+void coremark_default_params(coremark_params_t *params);
+
+// Parameters of a known profile by name ("2k-performance", "2k-validation", "6k-performance",
+// "6k-validation" or "profile"). Returns its known_id, -1 if there is no such profile.
+ee_s16 coremark_find_profile(const char *name, coremark_params_t *params);
+
+// Returns why params cannot be run, NULL if they can
+const char *coremark_params_error(const coremark_params_t *params);
+
+// known_id params are validated against, -1 if the crcs cannot be checked
+ee_s16 coremark_params_known_id(const coremark_params_t *params);
+
+// Name of a known_id profile, NULL if unknown
+const char *coremark_profile_name(ee_s16 known_id);
+
+// Use params for the next runs, NULL to go back to the build parameters. params must be
+// free of coremark_params_error. The data block is reserved right away, returns -1 if
+// there is not enough memory for it.
+int coremark_set_params(const coremark_params_t *params);
+
+// Run the benchmark. result may be NULL when only the UART log is wanted.
+MAIN_RETURN_TYPE coremark_main(coremark_result_t *result);
 
 #endif /* CORE_MAIN_H */
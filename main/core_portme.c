@@ -16,14 +16,41 @@ limitations under the License.
 Original Author: Shay Gal-on
 */
 
+#if !defined(ESP_PLATFORM)
+#define _GNU_SOURCE /* pthread_attr_setaffinity_np */
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <inttypes.h>
 #include "coremark.h"
+#include "core_main.h"
+#if defined(ESP_PLATFORM)
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/event_groups.h"
+#if defined(CONFIG_IDF_TARGET_ESP8266)
+#include "esp_task_wdt.h"
+#endif
+#include "esp_clk.h"
+#else
+#include <time.h>
+#include <unistd.h>
+#if USE_FREERTOS
+#include "FreeRTOS.h"
+#include "task.h"
+#include "event_groups.h"
+#endif
+#endif
 
+#if defined(CONFIG_COREMARK_AUTO_ITERATIONS)
+#define ITERATIONS 	0 // Calibrated by coremark_main to CALIBRATION_SECS
+#elif defined(CONFIG_ITERATIONS)
+#define ITERATIONS 	CONFIG_ITERATIONS
+#elif defined(ESP_PLATFORM)
 #define ITERATIONS 	2500 // Reduced iterations for testing
+#else
+#define ITERATIONS 	0 // Calibrated by coremark_main to CALIBRATION_SECS
+#endif
 
 #if VALIDATION_RUN
 	volatile ee_s32 seed1_volatile=0x3415;
@@ -53,13 +80,87 @@ Original Author: Shay Gal-on
 	Use lower values to increase resolution, but make sure that overflow does not occur.
 	If there are issues with the return value overflowing, increase this value.
 	*/
-#include "esp_timer.h"
+#if defined(ESP_PLATFORM) && defined(CONFIG_IDF_TARGET_ESP8266)
+#define ENTER_TIMING() taskENTER_CRITICAL()
+#define EXIT_TIMING() taskEXIT_CRITICAL()
+#elif defined(ESP_PLATFORM)
+/* ESP-IDF critical sections take a spinlock, which also keeps the other core out */
+static portMUX_TYPE timing_mux=portMUX_INITIALIZER_UNLOCKED;
+#define ENTER_TIMING() taskENTER_CRITICAL(&timing_mux)
+#define EXIT_TIMING() taskEXIT_CRITICAL(&timing_mux)
+#else
+#define ENTER_TIMING()
+#define EXIT_TIMING()
+#endif
 #define CORETIMETYPE CORE_TICKS
-#define GETMYTIME(_t) (*_t=esp_timer_get_time())
 #define MYTIMEDIFF(fin,ini) ((fin)-(ini))
 #define TIMER_RES_DIVIDER 1
 #define SAMPLE_TIME_IMPLEMENTATION 1
+
+#if (CORE_TIMER==CORE_TIMER_CYCLES)
+/* Ticks are cycles, at the clock read by <portable_init> (the counter rate for the TSC) */
+static CORE_TICKS cycles_per_sec=1;
+#define EE_TICKS_PER_SEC cycles_per_sec
+#if defined(__XTENSA__)
+/* CCOUNT is extended to 64 bits per core. It must be read at least once per wrap on the
+	core that times a run, which every chunk of <iterate_chunked> does. */
+#if defined(ESP_PLATFORM) && (portNUM_PROCESSORS>1)
+#define TIMER_CORES portNUM_PROCESSORS
+#define TIMER_CORE() xPortGetCoreID()
+#else
+#define TIMER_CORES 1
+#define TIMER_CORE() 0
+#endif
+static CORE_CYCLES cycles_last[TIMER_CORES];
+static CORE_TICKS cycles_high[TIMER_CORES];
+
+static CORE_TICKS cycles_now(void) {
+	CORE_TICKS now;
+	ENTER_TIMING();
+	int core=TIMER_CORE();
+	CORE_CYCLES ccount=portable_cycles();
+	if (ccount<cycles_last[core])
+		cycles_high[core]+=(CORE_TICKS)1<<32;
+	cycles_last[core]=ccount;
+	now=cycles_high[core]|ccount;
+	EXIT_TIMING();
+	return now;
+}
+#define GETMYTIME(_t) (*_t=cycles_now())
+#else
+#define GETMYTIME(_t) (*_t=(CORE_TICKS)portable_cycles())
+#endif
+#if !defined(ESP_PLATFORM) && !defined(CORE_CYCLES_ARE_NS)
+/* Function : tsc_per_sec
+	Rate of the host counter, measured against CLOCK_MONOTONIC_RAW over 50 ms.
+*/
+static CORE_TICKS tsc_per_sec(void) {
+	struct timespec t0,t1;
+	CORE_CYCLES c0,c1;
+	int64_t ns;
+	clock_gettime(CLOCK_MONOTONIC_RAW,&t0);
+	c0=portable_cycles();
+	do {
+		clock_gettime(CLOCK_MONOTONIC_RAW,&t1);
+		ns=(int64_t)(t1.tv_sec-t0.tv_sec)*1000000000LL+(t1.tv_nsec-t0.tv_nsec);
+	} while (ns<50000000LL);
+	c1=portable_cycles();
+	return (CORE_TICKS)((double)(c1-c0)*1e9/ns);
+}
+#endif
+#elif defined(ESP_PLATFORM)
+#include "esp_timer.h"
+#define GETMYTIME(_t) (*_t=esp_timer_get_time())
 #define EE_TICKS_PER_SEC (1000000LL)
+#else
+static CORE_TICKS posix_time_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (CORE_TICKS)ts.tv_sec*1000000000LL+ts.tv_nsec;
+}
+#define GETMYTIME(_t) (*_t=posix_time_ns())
+#define EE_TICKS_PER_SEC (1000000000LL)
+#endif
 
 /** Define Host specific (POSIX), or target specific global time variables. */
 static CORETIMETYPE start_time_val, stop_time_val;
@@ -71,15 +172,15 @@ static CORETIMETYPE start_time_val, stop_time_val;
 	or zeroing some system parameters - e.g. setting the cpu clocks cycles to 0.
 */
 void start_time(void) {
-    taskENTER_CRITICAL();
+    ENTER_TIMING();
     GETMYTIME(&start_time_val);
-    taskEXIT_CRITICAL();
+    EXIT_TIMING();
 }
 
 void stop_time(void) {
-    taskENTER_CRITICAL();
+    ENTER_TIMING();
     GETMYTIME(&stop_time_val);
-    taskEXIT_CRITICAL();
+    EXIT_TIMING();
 }
 
 CORE_TICKS get_time(void) {
@@ -92,7 +193,79 @@ secs_ret time_in_secs(CORE_TICKS ticks) {
     return retval;
 }
 
-ee_u32 default_num_contexts=1;
+/* Function : portable_ticks
+	Current value of the benchmark timer, in the same unit as <get_time>.
+	Used to time individual chunks of a run.
+*/
+CORE_TICKS portable_ticks(void) {
+    CORETIMETYPE now;
+    GETMYTIME(&now);
+    return now;
+}
+
+/* Function : portable_cpu_mhz
+	Clock the score is normalized to for CoreMark/MHz, 0 when unknown (host system timer,
+	or a host without a cycle counter).
+*/
+secs_ret portable_cpu_mhz(void) {
+#if defined(ESP_PLATFORM)
+	return esp_clk_cpu_freq()/1000000;
+#elif (CORE_TIMER==CORE_TIMER_CYCLES) && !defined(CORE_CYCLES_ARE_NS)
+	return (secs_ret)cycles_per_sec/1000000;
+#else
+	return 0;
+#endif
+}
+
+/* Function : portable_timer_name
+	Timer backend in use, for the report.
+*/
+const char *portable_timer_name(void) {
+#if (CORE_TIMER==CORE_TIMER_CYCLES)
+ #if defined(__XTENSA__)
+	return "CCOUNT";
+ #elif defined(CORE_CYCLES_ARE_NS)
+	return "CLOCK_MONOTONIC_RAW";
+ #else
+	return "TSC";
+ #endif
+#elif defined(ESP_PLATFORM)
+	return "esp_timer";
+#else
+	return "CLOCK_MONOTONIC";
+#endif
+}
+
+/* Function : portable_yield
+	Called between chunks of a run. On ESP8266 it feeds the watchdog and lets tasks of
+	the same priority run, without sleeping. The ESP-IDF task watchdog checks the IDLE
+	tasks instead, so there it sleeps one tick to let IDLE run on that core.
+	Time spent here is not counted in the score.
+*/
+void portable_yield(void) {
+#if defined(ESP_PLATFORM) && defined(CONFIG_IDF_TARGET_ESP8266)
+    esp_task_wdt_reset();
+    taskYIELD();
+#elif defined(ESP_PLATFORM)
+    vTaskDelay(1);
+#endif
+}
+
+ee_u32 default_num_contexts=MULTITHREAD;
+#if (MULTITHREAD>1) && (USE_PTHREAD || USE_FREERTOS)
+static ee_u32 contexts_started=0;
+#endif
+#if (MULTITHREAD>1) && USE_FREERTOS
+/* Bit 0 releases all contexts at once, bit (1+context) is set when a context is done */
+#define CONTEXTS_START_BIT (1<<0)
+#define CONTEXT_DONE_BIT(ctx) (1<<(1+(ctx)))
+#if defined(ESP_PLATFORM)
+#define CONTEXT_STACK_SIZE 4096
+#else
+#define CONTEXT_STACK_SIZE (configMINIMAL_STACK_SIZE*4)
+#endif
+static EventGroupHandle_t contexts_events=NULL;
+#endif
 
 /* Function : portable_init
 	Target specific initialization code 
@@ -106,6 +279,31 @@ void portable_init(core_portable *p, int *argc, char *argv[])
 	if (sizeof(ee_u32) != 4) {
 		ee_printf("ERROR! Please define ee_u32 to a 32b unsigned type!\n");
 	}
+#if (CORE_TIMER==CORE_TIMER_CYCLES)
+ #if defined(ESP_PLATFORM)
+	cycles_per_sec=esp_clk_cpu_freq();
+ #elif defined(CORE_CYCLES_ARE_NS)
+	cycles_per_sec=1000000000LL;
+ #else
+	if (cycles_per_sec<=1)
+		cycles_per_sec=tsc_per_sec();
+ #endif
+#endif
+	if (default_num_contexts<1 || default_num_contexts>MULTITHREAD) {
+		ee_printf("WARNING! %u contexts requested, using %u\n",(unsigned)default_num_contexts,(unsigned)MULTITHREAD);
+		default_num_contexts=MULTITHREAD;
+	}
+#if (MULTITHREAD>1) && (USE_PTHREAD || USE_FREERTOS)
+	contexts_started=0;
+#endif
+#if (MULTITHREAD>1) && USE_FREERTOS
+	if (contexts_events==NULL)
+		contexts_events=xEventGroupCreate();
+	if (contexts_events==NULL)
+		ee_printf("ERROR! Could not create the context event group!\n");
+	else
+		xEventGroupClearBits(contexts_events,0x00ffffff);
+#endif
 	p->portable_id=1;
 }
 /* Function : portable_fini
@@ -113,7 +311,227 @@ void portable_init(core_portable *p, int *argc, char *argv[])
 */
 void portable_fini(core_portable *p)
 {
+#if (MULTITHREAD>1) && USE_FREERTOS
+	if (contexts_events!=NULL) {
+		vEventGroupDelete(contexts_events);
+		contexts_events=NULL;
+	}
+#endif
 	p->portable_id=0;
 }
 
+/* Function : portable_malloc
+	Provide malloc() functionality in a platform specific way.
+*/
+void *portable_malloc(ee_size_t size) {
+	return malloc(size);
+}
+/* Function : portable_free
+	Provide free() functionality in a platform specific way.
+*/
+void portable_free(void *p) {
+	free(p);
+}
 
+#if (MEM_METHOD==MEM_ARENA)
+static void *arena=NULL;
+static ee_size_t arena_size=0;
+#endif
+/* Function : portable_arena
+	Data block of at least size bytes for <MEM_ARENA>. The block is kept for the next runs
+	and only reallocated when a run needs more, so switching profiles does not fragment the
+	heap. Its content is not preserved. Returns NULL if size cannot be allocated.
+*/
+void *portable_arena(ee_size_t size) {
+#if (MEM_METHOD==MEM_ARENA)
+	if (size>arena_size) {
+		portable_free(arena);
+		arena=portable_malloc(size);
+		arena_size=(arena!=NULL) ? size : 0;
+	}
+	return arena;
+#else
+	return NULL;
+#endif
+}
+
+#if (MULTITHREAD>1) && USE_PTHREAD
+/* Start barrier: contexts wait for the last one of the round to be created */
+static pthread_mutex_t contexts_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t contexts_go=PTHREAD_COND_INITIALIZER;
+static int contexts_released=0;
+
+static void contexts_release(int released) {
+	pthread_mutex_lock(&contexts_lock);
+	contexts_released=released;
+	if (released)
+		pthread_cond_broadcast(&contexts_go);
+	pthread_mutex_unlock(&contexts_lock);
+}
+
+/* Function : core_parallel_entry
+	Thread body for one context. Waits for the start barrier so all contexts begin together,
+	and records the time it spent in <iterate> so per-context throughput can be reported
+	next to the aggregate.
+*/
+static void *core_parallel_entry(void *pres) {
+	core_results *res=(core_results *)pres;
+	CORETIMETYPE t0,t1;
+	pthread_mutex_lock(&contexts_lock);
+	while (!contexts_released)
+		pthread_cond_wait(&contexts_go,&contexts_lock);
+	pthread_mutex_unlock(&contexts_lock);
+	GETMYTIME(&t0);
+	iterate(res);
+	GETMYTIME(&t1);
+	res->port.ticks=MYTIMEDIFF(t1,t0);
+	return NULL;
+}
+
+/* Function : core_start_parallel
+	Start one <iterate> context on a new pthread, created on core (context % online cpus).
+	Contexts are started in rounds of <default_num_contexts>, the last one of a round
+	releases all of them.
+*/
+ee_u8 core_start_parallel(core_results *res) {
+	long ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	int err;
+
+	res->port.context=contexts_started++%default_num_contexts;
+	res->port.ticks=0;
+	if (res->port.context==0)
+		contexts_release(0);
+	pthread_attr_init(&attr);
+	if (ncpu>0) {
+		CPU_ZERO(&cpus);
+		CPU_SET(res->port.context%(ee_u32)ncpu,&cpus);
+		err=pthread_attr_setaffinity_np(&attr,sizeof(cpus),&cpus);
+		if (err!=0)
+			ee_printf("WARNING! Could not pin context %u to a core (%d)\n",(unsigned)res->port.context,err);
+	}
+	err=pthread_create(&res->port.thread,&attr,core_parallel_entry,res);
+	pthread_attr_destroy(&attr);
+	if (err!=0) {
+		ee_printf("ERROR! pthread_create failed for context %u (%d)\n",(unsigned)res->port.context,err);
+		/* do not leave the contexts already created waiting */
+		contexts_release(1);
+		return 0;
+	}
+	if (res->port.context==default_num_contexts-1)
+		contexts_release(1);
+	return 1;
+}
+
+/* Function : core_stop_parallel
+	Join the context started by <core_start_parallel>.
+*/
+ee_u8 core_stop_parallel(core_results *res) {
+	int err=pthread_join(res->port.thread,NULL);
+	if (err!=0) {
+		ee_printf("ERROR! pthread_join failed for context %u (%d)\n",(unsigned)res->port.context,err);
+		return 0;
+	}
+	return 1;
+}
+#endif
+
+#if (MULTITHREAD>1) && USE_FREERTOS
+/* Function : core_parallel_task
+	Task body for one context. Waits for the start bit so all contexts begin together,
+	runs <iterate_chunked> so the watchdog stays fed, then reports completion through
+	its done bit and deletes itself.
+*/
+static void core_parallel_task(void *pres) {
+	core_results *res=(core_results *)pres;
+	xEventGroupWaitBits(contexts_events,CONTEXTS_START_BIT,pdFALSE,pdTRUE,portMAX_DELAY);
+	res->port.ticks=iterate_chunked(res);
+	xEventGroupSetBits(contexts_events,CONTEXT_DONE_BIT(res->port.context));
+	vTaskDelete(NULL);
+}
+
+/* Function : core_start_parallel
+	Create one task per context, pinned to core (context % portNUM_PROCESSORS) where the
+	kernel supports affinity. Contexts are started in rounds of <default_num_contexts>,
+	the last one of a round releases all of them.
+*/
+ee_u8 core_start_parallel(core_results *res) {
+	BaseType_t ok;
+	char name[configMAX_TASK_NAME_LEN];
+
+	if (contexts_events==NULL)
+		return 0;
+	res->port.context=contexts_started++%default_num_contexts;
+	res->port.ticks=0;
+	if (res->port.context==0)
+		xEventGroupClearBits(contexts_events,CONTEXTS_START_BIT);
+	snprintf(name,sizeof(name),"coremark%u",(unsigned)res->port.context);
+#if defined(ESP_PLATFORM) && (portNUM_PROCESSORS>1)
+	ok=xTaskCreatePinnedToCore(core_parallel_task,name,CONTEXT_STACK_SIZE,res,
+		uxTaskPriorityGet(NULL),&res->port.task,res->port.context%portNUM_PROCESSORS);
+#else
+	ok=xTaskCreate(core_parallel_task,name,CONTEXT_STACK_SIZE,res,
+		uxTaskPriorityGet(NULL),&res->port.task);
+#endif
+	if (ok!=pdPASS) {
+		ee_printf("ERROR! Could not create task for context %u\n",(unsigned)res->port.context);
+		return 0;
+	}
+	if (res->port.context==default_num_contexts-1)
+		xEventGroupSetBits(contexts_events,CONTEXTS_START_BIT);
+	return 1;
+}
+
+/* Function : core_stop_parallel
+	Wait for the context started by <core_start_parallel> to finish.
+*/
+ee_u8 core_stop_parallel(core_results *res) {
+	EventBits_t done=CONTEXT_DONE_BIT(res->port.context);
+	if (contexts_events==NULL)
+		return 0;
+	xEventGroupWaitBits(contexts_events,done,pdTRUE,pdTRUE,portMAX_DELAY);
+	res->port.task=NULL;
+	return 1;
+}
+#endif
+
+#if !defined(ESP_PLATFORM)
+#if USE_FREERTOS
+/* Function : host_main_task
+	Runs the benchmark from a task so the FreeRTOS POSIX simulator scheduler is up.
+*/
+static void host_main_task(void *arg) {
+	exit(coremark_main(NULL));
+}
+
+/* Function : vAssertCalled
+	configASSERT of host/freertos/FreeRTOSConfig.h.
+*/
+void vAssertCalled(const char *file, unsigned long line) {
+	fprintf(stderr,"FreeRTOS assert failed at %s:%lu\n",file,line);
+	abort();
+}
+#endif
+
+/* Function : main
+	Host entry point. Accepts -c<N> to run N contexts in parallel (N <= MULTITHREAD).
+	Left out with -DCORE_EXTERNAL_MAIN for host programs that call <coremark_main> themselves.
+*/
+#if !defined(CORE_EXTERNAL_MAIN)
+int main(int argc, char *argv[]) {
+	int i;
+	for (i=1; i<argc; i++) {
+		if (argv[i][0]=='-' && argv[i][1]=='c')
+			default_num_contexts=(ee_u32)strtoul(&argv[i][2],NULL,0);
+	}
+#if USE_FREERTOS
+	xTaskCreate(host_main_task,"coremark",configMINIMAL_STACK_SIZE*16,NULL,tskIDLE_PRIORITY+1,NULL);
+	vTaskStartScheduler();
+	return 1;
+#else
+	return coremark_main(NULL);
+#endif
+}
+#endif
+#endif
@@ -21,6 +21,9 @@ Original Author: Shay Gal-on
 */
 #ifndef CORE_PORTME_H
 #define CORE_PORTME_H
+#if defined(ESP_PLATFORM)
+#include "sdkconfig.h"
+#endif
 /************************/
 /* Data types and settings */
 /************************/
@@ -74,10 +77,11 @@ typedef int64_t CORE_TICKS;
  #endif
 #endif
 #ifndef COMPILER_FLAGS 
+ #ifdef CONFIG_OPTIMIZATION
  #define COMPILER_FLAGS CONFIG_OPTIMIZATION /* "Please put compiler flags here (e.g. -o3)" */
-#endif
-#ifndef MEM_LOCATION 
- #define MEM_LOCATION "STACK"
+ #else
+ #define COMPILER_FLAGS "Please put compiler flags here (e.g. -o3)"
+ #endif
 #endif
 
 /* Data Types :
@@ -94,7 +98,11 @@ typedef signed int ee_s32;
 typedef double ee_f32;
 typedef unsigned char ee_u8;
 typedef unsigned int ee_u32;
+#if defined(ESP_PLATFORM)
 typedef ee_u32 ee_ptr_int;
+#else
+typedef uintptr_t ee_ptr_int;
+#endif
 typedef size_t ee_size_t;
 /* align_mem :
 	This macro is used to align an offset to point to a 32b value. It is used in the Matrix algorithm to initialize the input memory blocks.
@@ -120,9 +128,35 @@ typedef size_t ee_size_t;
 	MEM_MALLOC - for platforms that implement malloc and have malloc.h.
 	MEM_STATIC - to use a static memory array.
 	MEM_STACK - to allocate the data block on the stack (NYI).
+	MEM_ARENA - from a heap block kept across runs, grown when a run needs more (<portable_arena>).
 */
 #ifndef MEM_METHOD
-#define MEM_METHOD MEM_STACK
+#define MEM_METHOD MEM_ARENA
+#endif
+#ifndef MEM_LOCATION 
+ #if (MEM_METHOD==MEM_ARENA) || (MEM_METHOD==MEM_MALLOC)
+ #define MEM_LOCATION "HEAP"
+ #elif (MEM_METHOD==MEM_STATIC)
+ #define MEM_LOCATION "STATIC"
+ #else
+ #define MEM_LOCATION "STACK"
+ #endif
+#endif
+
+/* Configuration : MIN_DATA_SIZE, MAX_DATA_SIZE
+	Bounds of the data size per context selected at run time with <coremark_set_params>.
+	The minimum is the one of the profile generation run, the maximum the one of the 6K runs
+	unless the block has a fixed size.
+*/
+#ifndef MIN_DATA_SIZE
+#define MIN_DATA_SIZE 1200
+#endif
+#ifndef MAX_DATA_SIZE
+ #if (MEM_METHOD==MEM_ARENA) || (MEM_METHOD==MEM_MALLOC)
+ #define MAX_DATA_SIZE 6000
+ #else
+ #define MAX_DATA_SIZE TOTAL_DATA_SIZE
+ #endif
 #endif
 
 /* Configuration : MULTITHREAD
@@ -139,13 +173,135 @@ typedef size_t ee_size_t;
 	
 	It is valid to have a different implementation of <core_start_parallel> and <core_end_parallel> in <core_portme.c>,
 	to fit a particular architecture. 
+
+	This port adds <USE_FREERTOS>, one task per context pinned to a core, which is the
+	default on the device when CONFIG_COREMARK_CONTEXTS is more than 1.
 */
 #ifndef MULTITHREAD
-#define MULTITHREAD 1
+ #ifdef CONFIG_COREMARK_CONTEXTS
+ #define MULTITHREAD CONFIG_COREMARK_CONTEXTS
+ #else
+ #define MULTITHREAD 1
+ #endif
+#endif
+#ifndef USE_PTHREAD
 #define USE_PTHREAD 0
+#endif
+#ifndef USE_FORK
 #define USE_FORK 0
+#endif
+#ifndef USE_SOCKET
 #define USE_SOCKET 0
 #endif
+#ifndef USE_FREERTOS
+ #if defined(ESP_PLATFORM) && (MULTITHREAD>1)
+ #define USE_FREERTOS 1
+ #else
+ #define USE_FREERTOS 0
+ #endif
+#endif
+
+#if (MULTITHREAD>1)
+ #if USE_PTHREAD
+ #include <pthread.h>
+ #define PARALLEL_METHOD "PThreads"
+ #elif USE_FREERTOS
+ #if defined(ESP_PLATFORM)
+ #include "freertos/FreeRTOS.h"
+ #include "freertos/task.h"
+ #else /* FreeRTOS POSIX simulator */
+ #include "FreeRTOS.h"
+ #include "task.h"
+ #endif
+ #define PARALLEL_METHOD "FreeRTOS"
+ #if (MULTITHREAD>23)
+ #error "USE_FREERTOS signals each context through one event group bit, use at most 23 contexts"
+ #endif
+ #else
+ #error "Please define a parallel method for MULTITHREAD>1 (e.g. USE_PTHREAD on a POSIX host)"
+ #endif
+#endif
+
+/* Configuration : CHUNK_ITERATIONS
+	Number of iterations run between two calls to <portable_yield>.
+	Keep a chunk well below the watchdog timeout on the slowest target (about 0.5 sec on ESP8266 at 80MHz).
+*/
+#ifndef CHUNK_ITERATIONS
+#define CHUNK_ITERATIONS 100
+#endif
+
+/* Configuration : CALIBRATION_SECS
+	Run time targeted when iterations are calibrated (seed 4 is 0).
+	Must stay above the 10 secs needed for a valid result.
+*/
+#ifndef CALIBRATION_SECS
+ #ifdef CONFIG_COREMARK_TIME_BUDGET
+ #define CALIBRATION_SECS CONFIG_COREMARK_TIME_BUDGET
+ #else
+ #define CALIBRATION_SECS 12
+ #endif
+#endif
+
+/* Configuration : CORE_PROFILE
+	Define to 1 to account the cycles spent in each kernel (list, matrix and state).
+	The counters are read around every kernel call, which costs a little throughput,
+	so keep it off for reported scores. When 0 the accounting compiles out.
+*/
+#ifndef CORE_PROFILE
+ #ifdef CONFIG_COREMARK_PROFILE_KERNELS
+ #define CORE_PROFILE 1
+ #else
+ #define CORE_PROFILE 0
+ #endif
+#endif
+
+/* Configuration : CORE_TIMER
+	Timer the benchmark is timed with.
+
+	Valid values :
+	CORE_TIMER_SYSTEM - esp_timer (1 us) on the device, CLOCK_MONOTONIC (1 ns) on a host (default).
+	CORE_TIMER_CYCLES - the cycle counter of <portable_cycles>, so ticks are CPU cycles and
+	CoreMark/MHz follows directly from the run. Needs a constant clock during the run.
+*/
+#define CORE_TIMER_SYSTEM 0
+#define CORE_TIMER_CYCLES 1
+#ifndef CORE_TIMER
+ #ifdef CONFIG_COREMARK_TIMER_CYCLES
+ #define CORE_TIMER CORE_TIMER_CYCLES
+ #else
+ #define CORE_TIMER CORE_TIMER_SYSTEM
+ #endif
+#endif
+
+/* Function : portable_cycles
+	Free running cycle counter used by <CORE_PROFILE> and <CORE_TIMER_CYCLES>: CCOUNT on
+	Xtensa, the TSC on x86 and CLOCK_MONOTONIC_RAW nanoseconds elsewhere. Only differences
+	of two readings taken on the same core are meaningful, and CCOUNT is 32 bits, so it
+	wraps every 2^32 cycles (about 18 secs at 240MHz).
+*/
+#if defined(__XTENSA__)
+typedef ee_u32 CORE_CYCLES;
+static inline CORE_CYCLES portable_cycles(void) {
+	CORE_CYCLES ccount;
+	__asm__ __volatile__("rsr %0, ccount" : "=a"(ccount));
+	return ccount;
+}
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+typedef uint64_t CORE_CYCLES;
+static inline CORE_CYCLES portable_cycles(void) {
+	return __rdtsc();
+}
+#else
+#include <time.h>
+#define CORE_CYCLES_ARE_NS 1
+typedef uint64_t CORE_CYCLES;
+static inline CORE_CYCLES portable_cycles(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return (CORE_CYCLES)ts.tv_sec*1000000000ULL+ts.tv_nsec;
+}
+#endif
 
 /* Configuration : MAIN_HAS_NOARGC
 	Needed if platform does not support getting arguments to main. 
@@ -184,12 +340,22 @@ typedef size_t ee_size_t;
 #endif
 
 /* Variable : default_num_contexts
-	Not used for this simple port, must cintain the value 1.
+	Number of contexts to run in parallel, must not exceed <MULTITHREAD>.
+	The POSIX host port accepts -c<N> on the command line to override it.
 */
 extern ee_u32 default_num_contexts;
 
 typedef struct CORE_PORTABLE_S {
 	ee_u8	portable_id;
+#if (MULTITHREAD>1)
+	ee_u32	context;	/* index of the context, used to pick a core */
+	CORE_TICKS	ticks;	/* time spent in <iterate> by this context */
+#if USE_PTHREAD
+	pthread_t	thread;
+#elif USE_FREERTOS
+	TaskHandle_t	task;
+#endif
+#endif
 } core_portable;
 
 /* target specific init/fini */
@@ -19,6 +19,8 @@ Original Author: Shay Gal-on
 /* Topic: Description
 	This file contains  declarations of the various benchmark functions.
 */
+#ifndef COREMARK_H
+#define COREMARK_H
 
 /* Configuration: TOTAL_DATA_SIZE
 	Define total size for data algorithms will operate on
@@ -34,6 +36,7 @@ Original Author: Shay Gal-on
 #define MEM_STATIC 0
 #define MEM_MALLOC 1
 #define MEM_STACK 2
+#define MEM_ARENA 3
 
 #include "core_portme.h"
 
@@ -69,6 +72,10 @@ void start_time(void);
 void stop_time(void);
 CORE_TICKS get_time(void);
 secs_ret time_in_secs(CORE_TICKS ticks);
+CORE_TICKS portable_ticks(void);
+secs_ret portable_cpu_mhz(void);
+const char *portable_timer_name(void);
+void portable_yield(void);
 
 /* Misc useful functions */
 ee_u16 crcu8(ee_u8 data, ee_u16 crc);
@@ -78,6 +85,7 @@ ee_u16 crcu32(ee_u32 newval, ee_u16 crc);
 ee_u8 check_data_types(void);
 void *portable_malloc(ee_size_t size);
 void portable_free(void *p);
+void *portable_arena(ee_size_t size);
 ee_s32 parseval(char *valstring);
 
 /* Algorithm IDS */
@@ -87,6 +95,22 @@ ee_s32 parseval(char *valstring);
 #define ALL_ALGORITHMS_MASK (ID_LIST|ID_MATRIX|ID_STATE)
 #define NUM_ALGORITHMS 3
 
+/* Kernel indexes of <CORE_PROFILE> counters, in the order of the algorithm ids */
+#define KERNEL_LIST 0
+#define KERNEL_MATRIX 1
+#define KERNEL_STATE 2
+
+/* Macros: PROFILE_START, PROFILE_ADD
+	Add the cycles elapsed since PROFILE_START(v) to kernel k of res, nothing unless <CORE_PROFILE>.
+*/
+#if CORE_PROFILE
+#define PROFILE_START(v) CORE_CYCLES v=portable_cycles()
+#define PROFILE_ADD(res,k,v) ((res)->kernel_cycles[k]+=(CORE_CYCLES)(portable_cycles()-(v)))
+#else
+#define PROFILE_START(v)
+#define PROFILE_ADD(res,k,v)
+#endif
+
 /* list data structures */
 typedef struct list_data_s {
 	ee_s16 data16;
@@ -149,10 +173,29 @@ typedef struct RESULTS_S {
 	ee_u16	crcmatrix;
 	ee_u16	crcstate;
 	ee_s16	err;
+#if CORE_PROFILE
+	CORE_TICKS	kernel_cycles[NUM_ALGORITHMS];	/* Cycles per kernel, list includes the others */
+#endif
 	/* ultithread specific */
 	core_portable port;
 } core_results;
 
+/* Chunked execution, see <iterate_chunk> and <iterate_chunked> */
+void iterate_chunk(core_results *res, ee_u32 first, ee_u32 count);
+CORE_TICKS iterate_chunked(core_results *res);
+
+/* Helper structure to hold the outcome of iterations calibration */
+typedef struct CORE_CALIBRATION_S {
+	ee_u32	probes;			/* Number of timed probe batches */
+	ee_u32	probe_iterations;	/* Iterations executed while probing, sizing included */
+	CORE_TICKS	probe_ticks;	/* Time spent probing, sizing included */
+	secs_ret	secs_per_iteration;	/* Fitted cost of one iteration */
+	secs_ret	overhead_secs;	/* Fitted fixed cost of one batch */
+	secs_ret	spread;		/* (max-min)/mean of the per-iteration cost over the probes */
+	secs_ret	target_secs;	/* Requested run time */
+	ee_u32	iterations;		/* Chosen number of iterations, 0 if not calibrated */
+} core_calibration;
+
 /* Multicore execution handling */
 #if (MULTITHREAD>1)
 ee_u8 core_start_parallel(core_results *res);
@@ -172,3 +215,4 @@ ee_u16 core_bench_state(ee_u32 blksize, ee_u8 *memblock,
 ee_u32 core_init_matrix(ee_u32 blksize, void *memblk, ee_s32 seed, mat_params *p);
 ee_u16 core_bench_matrix(mat_params *p, ee_s16 seed, ee_u16 crc);
 
+#endif /* COREMARK_H */
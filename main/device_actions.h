@@ -1,8 +1,11 @@
 #ifndef DEVICE_ACTIONS_H
 #define DEVICE_ACTIONS_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include "esp_err.h"
-#include "cJSON.h"
+#include "json_writer.h"
 
 // Define action types
 typedef enum {
@@ -12,14 +15,23 @@ typedef enum {
     ACTION_DELETE
 } action_method_t;
 
-// Structure to hold action response
+// Encoding of the reply, negotiated from the Accept header
+typedef enum {
+    ACTION_FORMAT_JSON,
+    ACTION_FORMAT_BINARY            // application/octet-stream, written with json_raw
+} action_format_t;
+
+// Request handed to an action
 typedef struct {
-    char *response;
-    esp_err_t status;
-} action_response_t;
+    const char *body;               // Request body, not NUL terminated, NULL when empty
+    size_t body_len;
+    action_format_t format;         // Only ACTION_FORMAT_BINARY for endpoints with binary set
+} action_request_t;
 
-// Function pointer type for actions
-typedef action_response_t (*action_handler_t)(const cJSON *request);
+// Function pointer type for actions. The reply is written to response, which is backed by
+// the server's shared buffer. On ESP_ERR_INVALID_ARG (bad request) or any other error the
+// output is discarded and an error reply is sent, so validate before writing.
+typedef esp_err_t (*action_handler_t)(const action_request_t *request, json_writer_t *response);
 
 // Structure to define an endpoint
 typedef struct {
@@ -27,15 +39,25 @@ typedef struct {
     action_method_t method;         // HTTP method
     action_handler_t handler;       // Handler function
     const char *description;        // Endpoint description
+    bool binary;                    // Handler can reply in ACTION_FORMAT_BINARY
 } device_endpoint_t;
 
 // Device configuration structure
 typedef struct {
-    const char *device_type;                    // Type of device (e.g., "plug", "sensor")
+    const char *device_type;                    // Type of device (e.g., "plug", "sensor"), URI prefix of the endpoints
     const device_endpoint_t *endpoints;         // Array of endpoints
     int num_endpoints;                          // Number of endpoints
     esp_err_t (*init)(void);                   // Device initialization function
     void (*deinit)(void);                      // Device cleanup function
+    int (*get_state)(void);                    // Current device state for benchmark records, may be NULL
+    int num_outputs;                           // Switchable outputs (relays) for device_batch_handler, 0 if none
+    int (*get_output)(int output);             // State of an output
+    void (*set_output)(int output, int state); // Switch an output, called with mutex held
+    bool (*get_power)(float *watts);           // Power meter (W) for benchmark efficiency, may be NULL
+    bool (*get_energy)(uint64_t *energy_uws);  // Energy meter (µWs) for benchmark efficiency, may be NULL
 } device_config_t;
 
+// Configuration of the device built into this firmware
+extern const device_config_t DEVICE_CONFIG;
+
 #endif // DEVICE_ACTIONS_H
@@ -0,0 +1,68 @@
+#include "device_batch.h"
+#include "json_reader.h"
+#include "web_server.h"
+
+typedef struct {
+    int32_t output;
+    int32_t state;
+} batch_op_t;
+
+typedef struct {
+    batch_op_t ops[DEVICE_BATCH_MAX_OPS];
+    size_t count;
+} batch_t;
+
+static esp_err_t batch_parse_op(void *ctx, size_t index, const char *buf, size_t len) {
+    batch_t *batch = (batch_t *)ctx;
+
+    if (index >= DEVICE_BATCH_MAX_OPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    batch_op_t *op = &batch->ops[index];
+    op->output = 0;
+    const json_field_t fields[] = {
+        { .key = "output", .type = JSON_FIELD_INT, .value = &op->output, .min = 0, .max = DEVICE_CONFIG.num_outputs - 1 },
+        { .key = "state", .type = JSON_FIELD_INT, .value = &op->state, .min = 0, .max = 1, .required = true },
+    };
+    esp_err_t err = json_parse_object(buf, len, fields, sizeof(fields) / sizeof(fields[0]), NULL);
+    if (err != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    batch->count = index + 1;
+    return ESP_OK;
+}
+
+esp_err_t device_batch_handler(const action_request_t *request, json_writer_t *response) {
+    batch_t batch;              // On the stack so concurrent requests do not share it
+
+    if (DEVICE_CONFIG.num_outputs <= 0 || DEVICE_CONFIG.set_output == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    batch.count = 0;
+    if (request->body == NULL ||
+        json_parse_array(request->body, request->body_len, batch_parse_op, &batch) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (size_t i = 0; i < batch.count; i++) {
+        batch_op_t *op = &batch.ops[i];
+        DEVICE_CONFIG.set_output(op->output, op->state);
+        if (DEVICE_CONFIG.get_output != NULL) {
+            op->state = DEVICE_CONFIG.get_output(op->output);
+        }
+    }
+    xSemaphoreGive(mutex);
+
+    json_obj_begin(response, NULL);
+    json_arr_begin(response, "results");
+    for (size_t i = 0; i < batch.count; i++) {
+        json_obj_begin(response, NULL);
+        json_int(response, "output", batch.ops[i].output);
+        json_int(response, "state", batch.ops[i].state);
+        json_obj_end(response);
+    }
+    json_arr_end(response);
+    json_obj_end(response);
+    return ESP_OK;
+}
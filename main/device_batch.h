@@ -0,0 +1,16 @@
+#ifndef DEVICE_BATCH_H
+#define DEVICE_BATCH_H
+
+#include "device_actions.h"
+
+// Largest number of operations in one batch
+#define DEVICE_BATCH_MAX_OPS 16
+
+// Action switching the outputs of DEVICE_CONFIG. The body is an array of
+// {"output": n, "state": 0|1} operations (output defaults to 0). All operations are
+// validated before any is applied, then applied in order under mutex, so other requests
+// see either none or all of them. Replies {"results": [{"output": n, "state": s}, ...]}
+// with the state of each output once its operation was applied.
+esp_err_t device_batch_handler(const action_request_t *request, json_writer_t *response);
+
+#endif // DEVICE_BATCH_H
@@ -4,29 +4,174 @@
 #include "freertos/task.h"
 #include "freertos/portmacro.h"
 
+// Pulse timestamps of one CF output, pushed by its ISR and drained by the gate timer.
+// The ISR is the only writer of head and stamps and never waits or masks interrupts:
+// when the consumer is more than PULSE_RING_SIZE pulses behind the oldest stamps are
+// overwritten, the pulse count stays exact.
+#define PULSE_RING_SIZE 32      // Power of two
+
+// Called while a ring is drained in test builds, host/hlw8012_test.c pushes pulses from it
+// to exercise the re-read
+#if HLW8012_TEST_HOOKS
+void hlw8012_drain_hook(const void *ring);
+#define HLW8012_DRAIN_HOOK(ring) hlw8012_drain_hook(ring)
+#else
+#define HLW8012_DRAIN_HOOK(ring)
+#endif
+
+typedef struct {
+    uint32_t stamps[PULSE_RING_SIZE];   // esp_timer time in us, wraps every 71 minutes
+    uint32_t head;                      // Pulses pushed since init
+} pulse_ring_t;
+
+// Pulses drained from a ring
+typedef struct {
+    uint32_t count;             // Pulses since the previous drain
+    uint32_t periods;           // Whole periods between first and last
+    uint32_t first;
+    uint32_t last;
+    bool contiguous;            // first is the pulse following the previous drain
+} pulse_window_t;
+
+// Frequency measurement of one CF output across windows
+typedef struct {
+    uint32_t reference;         // Last pulse of the previous windows
+    bool has_reference;
+    float frequency;            // Hz
+} pulse_meter_t;
+
 static hlw8012_config_t sensor_config;
 static hlw8012_readings_t current_readings = {0};
-static int64_t last_cf_pulse = 0;
-static int64_t last_cf1_pulse = 0;
+static esp_timer_handle_t gate_timer = NULL;
+
+static pulse_ring_t cf_ring;
+static pulse_ring_t cf1_ring;
+// Consumer positions, only touched by the gate timer
+static uint32_t cf_tail = 0;
+static uint32_t cf1_tail = 0;
+
+// Energy counted at every gate, in fixed point so it stays exact however long the uptime
+static uint64_t energy_uws = 0;
+static uint32_t pulse_uws = 0;          // Energy of one CF pulse, µWs
+
+static pulse_meter_t power_meter;
+static pulse_meter_t cf1_meter;
+static int sel_level = 0;               // SEL low measures current, high voltage
+
+static inline void IRAM_ATTR pulse_ring_push(pulse_ring_t *ring) {
+    uint32_t head = ring->head;
+    ring->stamps[head % PULSE_RING_SIZE] = (uint32_t)esp_timer_get_time();
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
 
 static bool IRAM_ATTR cf_isr_handler(void* arg) {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
-    last_cf_pulse = esp_timer_get_time();
-    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
-    return xHigherPriorityTaskWoken == pdTRUE;
+    pulse_ring_push(&cf_ring);
+    return false;
 }
 
 static bool IRAM_ATTR cf1_isr_handler(void* arg) {
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    UBaseType_t saved_interrupt_status = taskENTER_CRITICAL_FROM_ISR();
-    last_cf1_pulse = esp_timer_get_time();
-    taskEXIT_CRITICAL_FROM_ISR(saved_interrupt_status);
-    return xHigherPriorityTaskWoken == pdTRUE;
+    pulse_ring_push(&cf1_ring);
+    return false;
+}
+
+// Take the pulses pushed since *tail. At most the last PULSE_RING_SIZE / 2 stamps are read
+// so the ISR can push that many more before one of them is overwritten; if it did the
+// stamps are read again.
+static void pulse_ring_drain(const pulse_ring_t *ring, uint32_t *tail, pulse_window_t *window) {
+    uint32_t head, start;
+
+    do {
+        head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        window->count = head - *tail;
+        if (window->count == 0) {
+            break;
+        }
+        start = window->count > PULSE_RING_SIZE / 2 ? head - PULSE_RING_SIZE / 2 : *tail;
+        window->contiguous = start == *tail;
+        window->periods = head - 1 - start;
+        window->first = ring->stamps[start % PULSE_RING_SIZE];
+        HLW8012_DRAIN_HOOK(ring);
+        window->last = ring->stamps[(head - 1) % PULSE_RING_SIZE];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&ring->head, __ATOMIC_RELAXED) - start >= PULSE_RING_SIZE);
+    *tail = head;
+}
+
+// Update the frequency from the pulses of a closed window. The period runs from the
+// reference pulse (or the first pulse of the window) to the last one, so slow outputs
+// with less than one pulse per window are still measured. Without pulses the frequency
+// can only have dropped, it is capped by the time since the last pulse.
+static void meter_update(pulse_meter_t *meter, const pulse_window_t *window, uint32_t now) {
+    if (window->count > 0) {
+        uint32_t start = window->first;
+        uint32_t periods = window->periods;
+        if (meter->has_reference && window->contiguous) {
+            start = meter->reference;
+            periods++;
+        }
+        if (periods > 0 && window->last != start) {
+            meter->frequency = periods * 1000000.0f / (uint32_t)(window->last - start);
+        }
+        meter->reference = window->last;
+        meter->has_reference = true;
+    } else if (!meter->has_reference || now - meter->reference > HLW8012_PULSE_TIMEOUT_MS * 1000U) {
+        meter->frequency = 0;
+        meter->has_reference = false;
+    } else {
+        float bound = 1000000.0f / (uint32_t)(now - meter->reference);
+        if (bound < meter->frequency) {
+            meter->frequency = bound;
+        }
+    }
+}
+
+// Closes the counting windows and switches the SEL phase, runs every gate_ms from the
+// esp_timer task
+static void gate_timer_callback(void *arg) {
+    pulse_window_t cf, cf1;
+    int phase = sel_level;
+
+    pulse_ring_drain(&cf_ring, &cf_tail, &cf);
+    pulse_ring_drain(&cf1_ring, &cf1_tail, &cf1);
+
+    // Switch CF1 to the other quantity, pulses before the switch belong to the old one
+    sel_level = !sel_level;
+    gpio_set_level(sensor_config.sel_pin, sel_level);
+    cf1_tail = __atomic_load_n(&cf1_ring.head, __ATOMIC_ACQUIRE);
+
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    meter_update(&power_meter, &cf, now);
+    // CF1 restarts from its first pulse every phase, one pulse alone reads as zero
+    cf1_meter.frequency = 0;
+    cf1_meter.has_reference = false;
+    meter_update(&cf1_meter, &cf1, now);
+
+    float power = power_meter.frequency * sensor_config.power_multiplier;
+    uint64_t energy = energy_uws + (uint64_t)cf.count * pulse_uws;
+    float energy_kwh = energy / 3.6e12;
+    float cf1_value = cf1_meter.frequency *
+        (phase == 0 ? sensor_config.current_multiplier : sensor_config.voltage_multiplier);
+
+    taskENTER_CRITICAL();
+    energy_uws = energy;
+    current_readings.energy_uws = energy;
+    current_readings.energy = energy_kwh;
+    current_readings.power = power;
+    if (phase == 0) {
+        current_readings.current = cf1_value;
+    } else {
+        current_readings.voltage = cf1_value;
+    }
+    taskEXIT_CRITICAL();
 }
 
 esp_err_t hlw8012_init(const hlw8012_config_t *config) {
     sensor_config = *config;
+    if (sensor_config.gate_ms == 0) {
+        sensor_config.gate_ms = HLW8012_DEFAULT_GATE_MS;
+    }
+    // Each CF pulse is power_multiplier Ws
+    pulse_uws = (uint32_t)(sensor_config.power_multiplier * 1000000.0f + 0.5f);
     
     // Install GPIO ISR service
     ESP_ERROR_CHECK(gpio_install_isr_service(0));
@@ -58,8 +203,19 @@ esp_err_t hlw8012_init(const hlw8012_config_t *config) {
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
     };
     ESP_ERROR_CHECK(gpio_config(&sel_conf));
+    sel_level = 0;
+    gpio_set_level(sensor_config.sel_pin, sel_level);
     
-    return ESP_OK;
+    // Close a counting window every gate_ms
+    const esp_timer_create_args_t gate_args = {
+        .callback = gate_timer_callback,
+        .name = "hlw8012_gate",
+    };
+    esp_err_t ret = esp_timer_create(&gate_args, &gate_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    return esp_timer_start_periodic(gate_timer, sensor_config.gate_ms * 1000ULL);
 }
 
 esp_err_t hlw8012_get_readings(hlw8012_readings_t *readings) {
@@ -67,42 +223,18 @@ esp_err_t hlw8012_get_readings(hlw8012_readings_t *readings) {
         return ESP_ERR_INVALID_ARG;
     }
     
-    // Toggle SEL pin to read different values
-    gpio_set_level(sensor_config.sel_pin, 0);
-    vTaskDelay(pdMS_TO_TICKS(10));  // Wait for signal to stabilize
-    
-    // Calculate current
-    int64_t current_period = esp_timer_get_time() - last_cf1_pulse;
-    if (current_period > 0) {
-        current_readings.current = sensor_config.current_multiplier / current_period;
-    }
-    
-    gpio_set_level(sensor_config.sel_pin, 1);
-    vTaskDelay(pdMS_TO_TICKS(10));
-    
-    // Calculate voltage
-    int64_t voltage_period = esp_timer_get_time() - last_cf1_pulse;
-    if (voltage_period > 0) {
-        current_readings.voltage = sensor_config.voltage_multiplier / voltage_period;
-    }
-    
-    // Calculate power
-    int64_t power_period = esp_timer_get_time() - last_cf_pulse;
-    if (power_period > 0) {
-        // Convert microseconds to seconds and apply multiplier
-        float power_freq = 1000000.0f / power_period;  // Convert to frequency in Hz
-        current_readings.power = power_freq * sensor_config.power_multiplier;
-    }
-    
-    // Update energy (kWh) based on power
-    static int64_t last_energy_update = 0;
-    int64_t now = esp_timer_get_time();
-    if (last_energy_update > 0) {
-        float hours = (now - last_energy_update) / (3600.0 * 1000000.0);
-        current_readings.energy += (current_readings.power * hours) / 1000.0;
-    }
-    last_energy_update = now;
-    
+    taskENTER_CRITICAL();
     *readings = current_readings;
+    taskEXIT_CRITICAL();
     return ESP_OK;
 }
+
+void hlw8012_set_energy(uint64_t energy) {
+    float energy_kwh = energy / 3.6e12;
+
+    taskENTER_CRITICAL();
+    energy_uws = energy;
+    current_readings.energy_uws = energy;
+    current_readings.energy = energy_kwh;
+    taskEXIT_CRITICAL();
+}
@@ -1,26 +1,37 @@
 #ifndef HLW8012_H
 #define HLW8012_H
 
+#include <stdint.h>
 #include "esp_err.h"
 #include "driver/gpio.h"
 
+// Measurement window used when gate_ms is 0
+#define HLW8012_DEFAULT_GATE_MS 1000
+// A CF output without pulses for this long reads as zero
+#define HLW8012_PULSE_TIMEOUT_MS 10000
+
 typedef struct {
     gpio_num_t sel_pin;
     gpio_num_t cf_pin;
     gpio_num_t cf1_pin;
-    float current_multiplier;
-    float voltage_multiplier;
-    float power_multiplier;
+    float current_multiplier;   // A per Hz on CF1 with SEL low
+    float voltage_multiplier;   // V per Hz on CF1 with SEL high
+    float power_multiplier;     // W per Hz on CF
+    uint32_t gate_ms;           // Counting window, CF1 alternates current and voltage every window
 } hlw8012_config_t;
 
 typedef struct {
     float voltage;      // V
     float current;      // A
     float power;        // W
-    float energy;       // kWh
+    float energy;       // kWh, rounded from energy_uws
+    uint64_t energy_uws;    // Energy counted from the CF pulses, in µWs
 } hlw8012_readings_t;
 
 esp_err_t hlw8012_init(const hlw8012_config_t *config);
+// Latest readings computed from the pulse counts of the last windows, does not block
 esp_err_t hlw8012_get_readings(hlw8012_readings_t *readings);
+// Continue the energy count from a persisted value
+void hlw8012_set_energy(uint64_t energy_uws);
 
 #endif // HLW8012_H
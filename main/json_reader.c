@@ -0,0 +1,329 @@
+#include "json_reader.h"
+#include <string.h>
+
+// Longest member name that can match a field, longer names are skipped as unknown
+#define JSON_READER_MAX_KEY 32
+
+typedef struct {
+    const char *p;
+    const char *end;
+} json_reader_t;
+
+static void skip_ws(json_reader_t *r) {
+    while (r->p < r->end && (*r->p == ' ' || *r->p == '\t' || *r->p == '\n' || *r->p == '\r')) {
+        r->p++;
+    }
+}
+
+static bool consume(json_reader_t *r, char c) {
+    skip_ws(r);
+    if (r->p < r->end && *r->p == c) {
+        r->p++;
+        return true;
+    }
+    return false;
+}
+
+static bool consume_literal(json_reader_t *r, const char *lit) {
+    size_t n = strlen(lit);
+    if ((size_t)(r->end - r->p) < n || memcmp(r->p, lit, n) != 0) {
+        return false;
+    }
+    r->p += n;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Parse a string starting at the opening quote into out (NULL to skip it).
+// Escapes are decoded; \u is only accepted for ASCII code points.
+static esp_err_t parse_string(json_reader_t *r, char *out, size_t size) {
+    size_t n = 0;
+    bool fits = true;
+
+    if (!consume(r, '"')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (r->p < r->end) {
+        char c = *r->p++;
+        if (c == '"') {
+            if (out != NULL) {
+                if (!fits) {
+                    out[0] = '\0';
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                out[n] = '\0';
+            }
+            return ESP_OK;
+        }
+        if ((unsigned char)c < 0x20) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        if (c == '\\') {
+            if (r->p >= r->end) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            c = *r->p++;
+            switch (c) {
+                case '"': case '\\': case '/': break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case 'u': {
+                    int code = 0;
+                    if (r->end - r->p < 4) {
+                        return ESP_ERR_INVALID_ARG;
+                    }
+                    for (int i = 0; i < 4; i++) {
+                        int h = hex_value(*r->p++);
+                        if (h < 0) {
+                            return ESP_ERR_INVALID_ARG;
+                        }
+                        code = (code << 4) | h;
+                    }
+                    if (code == 0 || code > 0x7f) {
+                        return ESP_ERR_INVALID_ARG;
+                    }
+                    c = (char)code;
+                    break;
+                }
+                default:
+                    return ESP_ERR_INVALID_ARG;
+            }
+        }
+        if (out != NULL && fits) {
+            if (n + 1 < size) {
+                out[n++] = c;
+            } else {
+                fits = false;
+            }
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+// Parse an integer without fraction or exponent, rejecting values outside int32_t
+static esp_err_t parse_int(json_reader_t *r, int32_t *value) {
+    bool negative = false;
+    int64_t v = 0;
+
+    skip_ws(r);
+    if (r->p < r->end && *r->p == '-') {
+        negative = true;
+        r->p++;
+    }
+    if (r->p >= r->end || *r->p < '0' || *r->p > '9') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (*r->p == '0' && r->p + 1 < r->end && r->p[1] >= '0' && r->p[1] <= '9') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (r->p < r->end && *r->p >= '0' && *r->p <= '9') {
+        v = v * 10 + (*r->p++ - '0');
+        if (v > (int64_t)INT32_MAX + 1) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    if (r->p < r->end && (*r->p == '.' || *r->p == 'e' || *r->p == 'E')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (negative) {
+        v = -v;
+    }
+    if (v > INT32_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *value = (int32_t)v;
+    return ESP_OK;
+}
+
+// Skip a number of any form
+static esp_err_t skip_number(json_reader_t *r) {
+    const char *start = r->p;
+    if (r->p < r->end && *r->p == '-') {
+        r->p++;
+    }
+    if (r->p >= r->end || *r->p < '0' || *r->p > '9') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (r->p < r->end && strchr("0123456789.eE+-", *r->p) != NULL) {
+        r->p++;
+    }
+    return r->p > start ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// Skip the value of an unknown member, nested containers included
+static esp_err_t skip_value(json_reader_t *r, int depth) {
+    esp_err_t err;
+
+    skip_ws(r);
+    if (r->p >= r->end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    switch (*r->p) {
+        case '"':
+            return parse_string(r, NULL, 0);
+        case 't':
+            return consume_literal(r, "true") ? ESP_OK : ESP_ERR_INVALID_ARG;
+        case 'f':
+            return consume_literal(r, "false") ? ESP_OK : ESP_ERR_INVALID_ARG;
+        case 'n':
+            return consume_literal(r, "null") ? ESP_OK : ESP_ERR_INVALID_ARG;
+        case '{':
+        case '[': {
+            char close = *r->p == '{' ? '}' : ']';
+            bool object = close == '}';
+            if (depth >= JSON_READER_MAX_DEPTH) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            r->p++;
+            if (consume(r, close)) {
+                return ESP_OK;
+            }
+            do {
+                if (object) {
+                    if ((err = parse_string(r, NULL, 0)) != ESP_OK) {
+                        return err;
+                    }
+                    if (!consume(r, ':')) {
+                        return ESP_ERR_INVALID_ARG;
+                    }
+                }
+                if ((err = skip_value(r, depth + 1)) != ESP_OK) {
+                    return err;
+                }
+            } while (consume(r, ','));
+            return consume(r, close) ? ESP_OK : ESP_ERR_INVALID_ARG;
+        }
+        default:
+            return skip_number(r);
+    }
+}
+
+static esp_err_t parse_field(json_reader_t *r, const json_field_t *field) {
+    esp_err_t err;
+
+    skip_ws(r);
+    switch (field->type) {
+        case JSON_FIELD_INT: {
+            int32_t v;
+            if ((err = parse_int(r, &v)) != ESP_OK) {
+                return err;
+            }
+            if (v < field->min || v > field->max) {
+                return ESP_ERR_INVALID_ARG;
+            }
+            *(int32_t *)field->value = v;
+            return ESP_OK;
+        }
+        case JSON_FIELD_BOOL:
+            if (consume_literal(r, "true")) {
+                *(bool *)field->value = true;
+            } else if (consume_literal(r, "false")) {
+                *(bool *)field->value = false;
+            } else {
+                return ESP_ERR_INVALID_ARG;
+            }
+            return ESP_OK;
+        case JSON_FIELD_STR:
+            return parse_string(r, (char *)field->value, field->size);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t json_parse_object(const char *buf, size_t len, const json_field_t *fields,
+                            size_t num_fields, uint32_t *seen) {
+    json_reader_t r = { .p = buf, .end = buf + len };
+    char key[JSON_READER_MAX_KEY];
+    uint32_t found = 0;
+    esp_err_t err;
+
+    if (buf == NULL || num_fields > 32) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!consume(&r, '{')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!consume(&r, '}')) {
+        do {
+            err = parse_string(&r, key, sizeof(key));
+            if (err == ESP_ERR_INVALID_SIZE) {
+                key[0] = '\0';          // Too long for any field, skip the value
+            } else if (err != ESP_OK) {
+                return err;
+            }
+            if (!consume(&r, ':')) {
+                return ESP_ERR_INVALID_ARG;
+            }
+
+            size_t i;
+            for (i = 0; i < num_fields; i++) {
+                if (key[0] != '\0' && strcmp(key, fields[i].key) == 0) {
+                    break;
+                }
+            }
+            if (i == num_fields) {
+                err = skip_value(&r, 1);
+            } else if (found & (1u << i)) {
+                return ESP_ERR_INVALID_ARG;
+            } else {
+                found |= 1u << i;
+                err = parse_field(&r, &fields[i]);
+            }
+            if (err != ESP_OK) {
+                return err;
+            }
+        } while (consume(&r, ','));
+        if (!consume(&r, '}')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    skip_ws(&r);
+    if (r.p != r.end) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < num_fields; i++) {
+        if (fields[i].required && !(found & (1u << i))) {
+            return ESP_ERR_NOT_FOUND;
+        }
+    }
+    if (seen != NULL) {
+        *seen = found;
+    }
+    return ESP_OK;
+}
+
+esp_err_t json_parse_array(const char *buf, size_t len, json_element_fn_t fn, void *ctx) {
+    json_reader_t r = { .p = buf, .end = buf + len };
+    size_t index = 0;
+    esp_err_t err;
+
+    if (buf == NULL || !consume(&r, '[')) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!consume(&r, ']')) {
+        do {
+            skip_ws(&r);
+            const char *start = r.p;
+            if ((err = skip_value(&r, 1)) != ESP_OK) {
+                return err;
+            }
+            if ((err = fn(ctx, index++, start, r.p - start)) != ESP_OK) {
+                return err;
+            }
+        } while (consume(&r, ','));
+        if (!consume(&r, ']')) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    skip_ws(&r);
+    return r.p == r.end ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,49 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Largest request body accepted by the plug endpoints, sized for a full /plug/batch
+#define JSON_READER_MAX_BODY 512
+
+// Maximum nesting skipped inside values of unknown members
+#define JSON_READER_MAX_DEPTH 8
+
+typedef enum {
+    JSON_FIELD_INT,             // value points to int32_t, checked against min and max
+    JSON_FIELD_BOOL,            // value points to bool
+    JSON_FIELD_STR,             // value points to a char array of size bytes, NUL terminated
+} json_field_type_t;
+
+// One member of a flat request object
+typedef struct {
+    const char *key;
+    json_field_type_t type;
+    void *value;
+    size_t size;
+    int32_t min;
+    int32_t max;
+    bool required;
+} json_field_t;
+
+// Parse a single JSON object of len bytes (no NUL terminator needed) in one pass,
+// storing the members listed in fields and skipping unknown ones. Nothing is allocated.
+// Bit n of *seen (optional) is set when fields[n] was present.
+// Returns ESP_ERR_INVALID_ARG for malformed JSON, a wrong type, a duplicate member or
+// an integer out of range, ESP_ERR_INVALID_SIZE when a string does not fit and
+// ESP_ERR_NOT_FOUND when a required member is missing.
+esp_err_t json_parse_object(const char *buf, size_t len, const json_field_t *fields,
+                            size_t num_fields, uint32_t *seen);
+
+// Called for each element of an array with its len bytes of JSON, surrounding whitespace
+// excluded. Any error stops the parse and is returned by json_parse_array.
+typedef esp_err_t (*json_element_fn_t)(void *ctx, size_t index, const char *buf, size_t len);
+
+// Parse a JSON array of len bytes, handing each element to fn (json_parse_object for
+// arrays of objects). Returns ESP_ERR_INVALID_ARG for malformed JSON.
+esp_err_t json_parse_array(const char *buf, size_t len, json_element_fn_t fn, void *ctx);
+
+#endif // JSON_READER_H
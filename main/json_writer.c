@@ -0,0 +1,204 @@
+#include "json_writer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_fn_t flush, void *ctx) {
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->flush = flush;
+    w->ctx = ctx;
+    w->has_items = 0;
+    w->depth = 0;
+    w->overflow = false;
+    w->err = ESP_OK;
+}
+
+esp_err_t json_writer_flush(json_writer_t *w) {
+    if (w->flush != NULL && w->len > 0 && w->err == ESP_OK) {
+        w->err = w->flush(w->ctx, w->buf, w->len);
+    }
+    w->len = 0;
+    return w->err;
+}
+
+esp_err_t json_writer_status(const json_writer_t *w) {
+    if (w->err != ESP_OK) {
+        return w->err;
+    }
+    return w->overflow ? ESP_ERR_INVALID_SIZE : ESP_OK;
+}
+
+static void put(json_writer_t *w, const char *data, size_t len) {
+    while (len > 0) {
+        size_t room = w->size - w->len;
+        if (room == 0) {
+            if (w->flush == NULL) {
+                w->overflow = true;
+                return;
+            }
+            json_writer_flush(w);
+            room = w->size;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void put_char(json_writer_t *w, char c) {
+    put(w, &c, 1);
+}
+
+static void put_string(json_writer_t *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+    const char *run = s;
+
+    put_char(w, '"');
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        put(w, run, s - run);
+        run = s + 1;
+        switch (c) {
+        case '"':  put(w, "\\\"", 2); break;
+        case '\\': put(w, "\\\\", 2); break;
+        case '\n': put(w, "\\n", 2); break;
+        case '\r': put(w, "\\r", 2); break;
+        case '\t': put(w, "\\t", 2); break;
+        default: {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xf]};
+            put(w, esc, sizeof(esc));
+            break;
+        }
+        }
+    }
+    put(w, run, s - run);
+    put_char(w, '"');
+}
+
+// Separator and member name of the next value
+static void begin_value(json_writer_t *w, const char *key) {
+    uint32_t bit = 1u << (w->depth % JSON_WRITER_MAX_DEPTH);
+    if (w->depth > 0) {
+        if (w->has_items & bit) {
+            put_char(w, ',');
+        }
+        w->has_items |= bit;
+    }
+    if (key != NULL) {
+        put_string(w, key);
+        put_char(w, ':');
+    }
+}
+
+static void open_container(json_writer_t *w, const char *key, char c) {
+    begin_value(w, key);
+    put_char(w, c);
+    if (w->depth + 1 < JSON_WRITER_MAX_DEPTH) {
+        w->depth++;
+        w->has_items &= ~(1u << w->depth);
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void close_container(json_writer_t *w, char c) {
+    if (w->depth > 0) {
+        w->depth--;
+    }
+    put_char(w, c);
+}
+
+void json_obj_begin(json_writer_t *w, const char *key) {
+    open_container(w, key, '{');
+}
+
+void json_obj_end(json_writer_t *w) {
+    close_container(w, '}');
+}
+
+void json_arr_begin(json_writer_t *w, const char *key) {
+    open_container(w, key, '[');
+}
+
+void json_arr_end(json_writer_t *w) {
+    close_container(w, ']');
+}
+
+void json_str(json_writer_t *w, const char *key, const char *value) {
+    begin_value(w, key);
+    if (value == NULL) {
+        put(w, "null", 4);
+    } else {
+        put_string(w, value);
+    }
+}
+
+void json_int(json_writer_t *w, const char *key, int64_t value) {
+    char num[24];
+    begin_value(w, key);
+    // Negate as unsigned so INT64_MIN does not overflow
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    int n = sizeof(num);
+    do {
+        num[--n] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (value < 0) {
+        num[--n] = '-';
+    }
+    put(w, num + n, sizeof(num) - n);
+}
+
+void json_uint(json_writer_t *w, const char *key, uint64_t value) {
+    char num[24];
+    begin_value(w, key);
+    int n = sizeof(num);
+    do {
+        num[--n] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    put(w, num + n, sizeof(num) - n);
+}
+
+void json_double(json_writer_t *w, const char *key, double value) {
+    char num[32];
+    if (!isfinite(value)) {
+        json_null(w, key);
+        return;
+    }
+    begin_value(w, key);
+    // Integral values print without exponent or fraction, like cJSON does
+    // Range first, the cast is undefined for values out of int64_t range
+    if (fabs(value) < 1e15 && value == (double)(int64_t)value) {
+        int n = snprintf(num, sizeof(num), "%lld", (long long)value);
+        put(w, num, n);
+        return;
+    }
+    int n = snprintf(num, sizeof(num), "%.10g", value);
+    put(w, num, n > 0 && n < (int)sizeof(num) ? n : 0);
+}
+
+void json_bool(json_writer_t *w, const char *key, bool value) {
+    begin_value(w, key);
+    if (value) {
+        put(w, "true", 4);
+    } else {
+        put(w, "false", 5);
+    }
+}
+
+void json_null(json_writer_t *w, const char *key) {
+    begin_value(w, key);
+    put(w, "null", 4);
+}
+
+void json_raw(json_writer_t *w, const void *data, size_t len) {
+    put(w, (const char *)data, len);
+}
@@ -0,0 +1,54 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Maximum nesting of objects and arrays
+#define JSON_WRITER_MAX_DEPTH 32
+
+// Called with the buffered output when the buffer is full, and by json_writer_flush
+typedef esp_err_t (*json_flush_fn_t)(void *ctx, const char *data, size_t len);
+
+// Compact JSON emitter writing into a caller-provided buffer, without any allocation.
+// When flush is NULL output that does not fit sets overflow and is dropped.
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;                 // Bytes currently buffered
+    json_flush_fn_t flush;
+    void *ctx;
+    uint32_t has_items;         // Bit n set once the container at depth n has an item
+    uint8_t depth;
+    bool overflow;              // Output was dropped
+    esp_err_t err;              // First error returned by flush
+} json_writer_t;
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_fn_t flush, void *ctx);
+
+// key is the member name inside an object, NULL at top level and inside arrays
+void json_obj_begin(json_writer_t *w, const char *key);
+void json_obj_end(json_writer_t *w);
+void json_arr_begin(json_writer_t *w, const char *key);
+void json_arr_end(json_writer_t *w);
+
+void json_str(json_writer_t *w, const char *key, const char *value);
+void json_int(json_writer_t *w, const char *key, int64_t value);
+void json_uint(json_writer_t *w, const char *key, uint64_t value);
+// Non-finite values are written as null
+void json_double(json_writer_t *w, const char *key, double value);
+void json_bool(json_writer_t *w, const char *key, bool value);
+void json_null(json_writer_t *w, const char *key);
+
+// Append len bytes as is, for bodies that are not JSON (see ACTION_FORMAT_BINARY)
+void json_raw(json_writer_t *w, const void *data, size_t len);
+
+// Hand the buffered output to flush, if any
+esp_err_t json_writer_flush(json_writer_t *w);
+
+// ESP_OK if everything written so far was kept
+esp_err_t json_writer_status(const json_writer_t *w);
+
+#endif // JSON_WRITER_H
@@ -0,0 +1,162 @@
+#include "load_generator.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_http_client.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Above the benchmark task so the load keeps its rate, below the HTTP server
+#define LOAD_TASK_PRIORITY (tskIDLE_PRIORITY + 4)
+#define LOAD_TASK_STACK 4096
+#define LOAD_REQUEST_TIMEOUT_MS 1000
+// Share of the requested rate the load must reach for load_generator_ok
+#define LOAD_MIN_RATE_SHARE 0.9f
+
+// Requests are paced to the microsecond but waited for in whole ticks
+#if LOAD_GENERATOR_MAX_RATE > configTICK_RATE_HZ
+#error "LOAD_GENERATOR_MAX_RATE is above the tick rate"
+#endif
+
+static const char *TAG = "load_generator";
+
+static uint32_t latencies[LOAD_GENERATOR_MAX_SAMPLES];
+static load_generator_stats_t stats;
+static const char *load_url;
+static load_generator_state_fn_t load_get_state;
+static bool load_running = false;        // Of the caller, the load task waits on load_stop
+static SemaphoreHandle_t load_stop = NULL;
+static SemaphoreHandle_t load_done = NULL;
+static int64_t load_start_us;
+static int64_t load_stop_us;
+
+static void load_task(void *pvParameters) {
+    char body[16];
+    esp_http_client_config_t config = {
+        .url = load_url,
+        .timeout_ms = LOAD_REQUEST_TIMEOUT_MS,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    // Paced on esp_timer: a period of whole ticks would round 25 ms (40 requests per
+    // second) down to 20 ms with CONFIG_FREERTOS_HZ=100
+    int64_t period_us = 1000000 / stats.rate;
+    int64_t next_us = esp_timer_get_time();
+
+    while (client != NULL) {
+        bool put = (stats.requests % 2) == 1;
+        if (put) {
+            snprintf(body, sizeof(body), "{\"state\": %d}", load_get_state());
+            esp_http_client_set_method(client, HTTP_METHOD_PUT);
+            esp_http_client_set_header(client, "Content-Type", "application/json");
+            esp_http_client_set_post_field(client, body, strlen(body));
+        } else {
+            esp_http_client_set_method(client, HTTP_METHOD_GET);
+            esp_http_client_set_post_field(client, NULL, 0);
+        }
+
+        int64_t start = esp_timer_get_time();
+        esp_err_t err = esp_http_client_perform(client);
+        uint32_t latency = (uint32_t)(esp_timer_get_time() - start);
+
+        latencies[stats.requests % LOAD_GENERATOR_MAX_SAMPLES] = latency;
+        stats.requests++;
+        if (err != ESP_OK || esp_http_client_get_status_code(client) != 200) {
+            stats.failures++;
+        }
+
+        next_us += period_us;
+        int64_t now = esp_timer_get_time();
+        TickType_t wait = 0;
+        if (next_us < now - period_us) {
+            // Requests take longer than the period, do not burst to catch up
+            next_us = now;
+        } else if (next_us > now) {
+            wait = (TickType_t)(((next_us - now) * configTICK_RATE_HZ + 999999) / 1000000);
+        }
+        if (xSemaphoreTake(load_stop, wait) == pdTRUE) {
+            break;
+        }
+    }
+    if (client != NULL) {
+        esp_http_client_cleanup(client);
+    } else {
+        ESP_LOGE(TAG, "Failed to create HTTP client");
+    }
+    load_stop_us = esp_timer_get_time();
+    xSemaphoreGive(load_done);
+    vTaskDelete(NULL);
+}
+
+esp_err_t load_generator_start(const char *url, uint32_t rate, load_generator_state_fn_t get_state) {
+    if (load_running || url == NULL || get_state == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (load_stop == NULL) {
+        load_stop = xSemaphoreCreateBinary();
+    }
+    if (load_done == NULL) {
+        load_done = xSemaphoreCreateBinary();
+    }
+    if (load_stop == NULL || load_done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (rate < LOAD_GENERATOR_MIN_RATE || rate > LOAD_GENERATOR_MAX_RATE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.rate = rate;
+    load_url = url;
+    load_get_state = get_state;
+    load_running = true;
+    load_start_us = esp_timer_get_time();
+    // Left given when the previous load task ended without a client
+    xSemaphoreTake(load_stop, 0);
+    if (xTaskCreate(load_task, "load", LOAD_TASK_STACK, NULL, LOAD_TASK_PRIORITY, NULL) != pdPASS) {
+        load_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, uint32_t pct) {
+    return sorted[(count - 1) * pct / 100];
+}
+
+esp_err_t load_generator_stop(load_generator_stats_t *out) {
+    if (!load_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    load_running = false;
+    xSemaphoreGive(load_stop);
+    xSemaphoreTake(load_done, portMAX_DELAY);
+
+    uint32_t samples = stats.requests < LOAD_GENERATOR_MAX_SAMPLES ? stats.requests : LOAD_GENERATOR_MAX_SAMPLES;
+    if (samples > 0) {
+        // Sorted in place, the samples are not needed once the load is stopped
+        qsort(latencies, samples, sizeof(latencies[0]), compare_u32);
+        stats.p50_us = percentile(latencies, samples, 50);
+        stats.p90_us = percentile(latencies, samples, 90);
+        stats.p99_us = percentile(latencies, samples, 99);
+        stats.max_us = latencies[samples - 1];
+    }
+    if (load_stop_us > load_start_us) {
+        stats.achieved_rate = stats.requests * 1000000.0f / (load_stop_us - load_start_us);
+    }
+    *out = stats;
+    return ESP_OK;
+}
+
+bool load_generator_ok(const load_generator_stats_t *stats) {
+    return stats->requests > 0 && stats->failures == 0 &&
+           stats->achieved_rate >= stats->rate * LOAD_MIN_RATE_SHARE;
+}
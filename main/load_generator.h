@@ -0,0 +1,40 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Bounds for the request rate (requests per second), other rates are rejected
+#define LOAD_GENERATOR_MIN_RATE 1
+#define LOAD_GENERATOR_MAX_RATE 50
+// Latency samples kept for the percentiles, the oldest ones are overwritten
+#define LOAD_GENERATOR_MAX_SAMPLES 512
+
+// Outcome of a load run
+typedef struct {
+    uint32_t rate;              // Requested rate (requests per second)
+    uint32_t requests;          // Requests issued
+    uint32_t failures;          // Requests that failed or did not return 200
+    float achieved_rate;        // Requests per second actually issued
+    uint32_t p50_us;            // Latency percentiles over the kept samples
+    uint32_t p90_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} load_generator_stats_t;
+
+// Returns the plug state the PUT requests write back, so the relay is not switched
+typedef int (*load_generator_state_fn_t)(void);
+
+// Start issuing alternating GET and PUT requests to url at rate requests per second.
+// Returns ESP_ERR_INVALID_ARG when rate is outside the bounds.
+esp_err_t load_generator_start(const char *url, uint32_t rate, load_generator_state_fn_t get_state);
+
+// Stop the load, wait for the last request and fill stats
+esp_err_t load_generator_stop(load_generator_stats_t *stats);
+
+// True when the run actually loaded the server: requests were issued, none failed and
+// they came at 90% of the requested rate at least
+bool load_generator_ok(const load_generator_stats_t *stats);
+
+#endif // LOAD_GENERATOR_H
@@ -0,0 +1,41 @@
+#include "plug_telemetry.h"
+#include <string.h>
+
+void plug_telemetry_write_json(json_writer_t *w, const plug_telemetry_t *t) {
+    json_obj_begin(w, NULL);
+    json_int(w, "state", t->state);
+    json_double(w, "voltage", t->voltage);
+    json_double(w, "current", t->current);
+    json_double(w, "power", t->power);
+    json_double(w, "energy", t->energy_uws / 3.6e12);
+    if (t->sample_age_ms >= 0) {
+        json_int(w, "sample_age_ms", t->sample_age_ms);
+    } else {
+        json_null(w, "sample_age_ms");
+    }
+    json_obj_end(w);
+}
+
+// Byte by byte so the layout does not depend on the host byte order
+static void put_le(uint8_t *buf, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void put_float(uint8_t *buf, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_le(buf, bits, 4);
+}
+
+void plug_telemetry_encode(const plug_telemetry_t *t, uint8_t *buf) {
+    buf[0] = PLUG_TELEMETRY_VERSION;
+    buf[1] = (uint8_t)t->state;
+    put_le(buf + 2, 0, 2);
+    put_float(buf + 4, t->voltage);
+    put_float(buf + 8, t->current);
+    put_float(buf + 12, t->power);
+    put_le(buf + 16, t->energy_uws, 8);
+    put_le(buf + 24, (uint32_t)t->sample_age_ms, 4);
+}
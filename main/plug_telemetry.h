@@ -0,0 +1,38 @@
+#ifndef PLUG_TELEMETRY_H
+#define PLUG_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+// Version byte leading the binary form, bumped when the layout changes
+#define PLUG_TELEMETRY_VERSION 1
+
+// Binary form, all little endian:
+//   0  uint8   version
+//   1  uint8   state
+//   2  uint16  reserved, 0
+//   4  float32 voltage (V)
+//   8  float32 current (A)
+//  12  float32 power (W)
+//  16  uint64  energy (µWs)
+//  24  int32   sample age (ms), -1 before the first sample
+#define PLUG_TELEMETRY_BINARY_SIZE 28
+
+// State and readings served by GET /plug/state
+typedef struct {
+    int state;
+    float voltage;
+    float current;
+    float power;
+    uint64_t energy_uws;
+    int32_t sample_age_ms;      // -1 before the first sample
+} plug_telemetry_t;
+
+// JSON object with energy in kWh and a null sample_age_ms before the first sample
+void plug_telemetry_write_json(json_writer_t *w, const plug_telemetry_t *t);
+
+// Encode the binary form into buf, which holds PLUG_TELEMETRY_BINARY_SIZE bytes
+void plug_telemetry_encode(const plug_telemetry_t *t, uint8_t *buf);
+
+#endif // PLUG_TELEMETRY_H
@@ -0,0 +1,174 @@
+#include "power_history.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+// Entries accumulated for the period in progress
+typedef struct {
+    uint32_t period;            // Index of the period, time / resolution
+    uint32_t sum;
+    uint16_t samples;
+    uint16_t min;
+    uint16_t max;
+} tier_accumulator_t;
+
+typedef struct {
+    uint32_t resolution;        // Seconds per entry
+    uint16_t size;
+    uint16_t count;             // Entries stored, up to size
+    uint16_t next;              // Slot the next entry goes to
+    uint32_t last_period;       // Period of the newest entry
+    power_history_entry_t *entries;
+    tier_accumulator_t acc;
+} power_tier_t;
+
+#define TIER_1S_SIZE 600
+#define TIER_1M_SIZE 1440
+#define TIER_15M_SIZE 672
+
+static power_history_entry_t entries_1s[TIER_1S_SIZE];
+static power_history_entry_t entries_1m[TIER_1M_SIZE];
+static power_history_entry_t entries_15m[TIER_15M_SIZE];
+
+static power_tier_t tiers[POWER_HISTORY_TIERS] = {
+    { .resolution = 1, .size = TIER_1S_SIZE, .entries = entries_1s },
+    { .resolution = 60, .size = TIER_1M_SIZE, .entries = entries_1m },
+    { .resolution = 900, .size = TIER_15M_SIZE, .entries = entries_15m },
+};
+
+static SemaphoreHandle_t history_mutex = NULL;
+
+static void tier_push(power_tier_t *tier, const power_history_entry_t *entry) {
+    tier->entries[tier->next] = *entry;
+    tier->next = (tier->next + 1) % tier->size;
+    if (tier->count < tier->size) {
+        tier->count++;
+    }
+}
+
+// Store the period in progress, after empty entries for the periods without samples
+static void tier_close(power_tier_t *tier) {
+    tier_accumulator_t *acc = &tier->acc;
+    static const power_history_entry_t no_data = {
+        POWER_HISTORY_NO_DATA, POWER_HISTORY_NO_DATA, POWER_HISTORY_NO_DATA
+    };
+
+    if (tier->count > 0) {
+        uint32_t gap = acc->period - tier->last_period - 1;
+        for (uint32_t i = 0; i < gap && i < tier->size; i++) {
+            tier_push(tier, &no_data);
+        }
+    }
+    power_history_entry_t entry = {
+        .min = acc->min,
+        .max = acc->max,
+        .mean = (acc->sum + acc->samples / 2) / acc->samples,
+    };
+    tier_push(tier, &entry);
+    tier->last_period = acc->period;
+}
+
+esp_err_t power_history_init(void) {
+    if (history_mutex == NULL) {
+        history_mutex = xSemaphoreCreateMutex();
+        if (history_mutex == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    for (int i = 0; i < POWER_HISTORY_TIERS; i++) {
+        tiers[i].count = 0;
+        tiers[i].next = 0;
+        memset(&tiers[i].acc, 0, sizeof(tiers[i].acc));
+    }
+    return ESP_OK;
+}
+
+void power_history_add(int64_t now, float power) {
+    uint32_t time = (uint32_t)(now / 1000000);
+    uint16_t value;
+
+    if (history_mutex == NULL || xSemaphoreTake(history_mutex, 0) != pdTRUE) {
+        return;
+    }
+    if (power < 0) {
+        value = 0;
+    } else if (power * 10 >= POWER_HISTORY_NO_DATA - 1) {
+        value = POWER_HISTORY_NO_DATA - 1;
+    } else {
+        value = (uint16_t)(power * 10 + 0.5f);
+    }
+
+    for (int i = 0; i < POWER_HISTORY_TIERS; i++) {
+        power_tier_t *tier = &tiers[i];
+        tier_accumulator_t *acc = &tier->acc;
+        uint32_t period = time / tier->resolution;
+
+        if (acc->samples > 0 && period != acc->period) {
+            tier_close(tier);
+            acc->samples = 0;
+        }
+        if (acc->samples == 0) {
+            acc->period = period;
+            acc->sum = 0;
+            acc->min = value;
+            acc->max = value;
+        }
+        acc->sum += value;
+        acc->samples++;
+        if (value < acc->min) {
+            acc->min = value;
+        }
+        if (value > acc->max) {
+            acc->max = value;
+        }
+    }
+    xSemaphoreGive(history_mutex);
+}
+
+uint32_t power_history_resolution(uint32_t from) {
+    for (int i = 0; i < POWER_HISTORY_TIERS; i++) {
+        const power_tier_t *tier = &tiers[i];
+        // Oldest time the tier can hold, counted back from its newest entry
+        uint32_t span = tier->size * tier->resolution;
+        uint32_t newest = tier->count > 0 ? (tier->last_period + 1) * tier->resolution : 0;
+        if (newest < span || from >= newest - span) {
+            return tier->resolution;
+        }
+    }
+    return tiers[POWER_HISTORY_TIERS - 1].resolution;
+}
+
+esp_err_t power_history_read(uint32_t res, uint32_t *from, power_history_entry_t *entries,
+                             size_t *count, uint32_t *time) {
+    const power_tier_t *tier = NULL;
+    size_t max = *count;
+
+    *count = 0;
+    for (int i = 0; i < POWER_HISTORY_TIERS; i++) {
+        if (tiers[i].resolution == res) {
+            tier = &tiers[i];
+        }
+    }
+    if (tier == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (history_mutex == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Only copies under the lock, the caller sends without holding it
+    xSemaphoreTake(history_mutex, portMAX_DELAY);
+    uint32_t first = (tier->next + tier->size - tier->count) % tier->size;
+    uint32_t first_period = tier->last_period + 1 - tier->count;
+    uint32_t from_period = *from / res + (*from % res != 0);
+    uint32_t skip = from_period > first_period ? from_period - first_period : 0;
+    for (uint32_t i = skip; i < tier->count && *count < max; i++) {
+        entries[(*count)++] = tier->entries[(first + i) % tier->size];
+    }
+    if (*count > 0) {
+        *time = (first_period + skip) * res;
+        *from = *time + *count * res;
+    }
+    xSemaphoreGive(history_mutex);
+    return ESP_OK;
+}
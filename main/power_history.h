@@ -0,0 +1,38 @@
+#ifndef POWER_HISTORY_H
+#define POWER_HISTORY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Number of resolutions kept: 1 s for 10 minutes, 1 min for a day, 15 min for a week
+#define POWER_HISTORY_TIERS 3
+
+// Stored in min, max and mean for periods without samples
+#define POWER_HISTORY_NO_DATA 0xFFFF
+
+// Power over one period, in 0.1 W
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint16_t mean;
+} power_history_entry_t;
+
+esp_err_t power_history_init(void);
+
+// Add a power sample taken at now (esp_timer time). Samples are dropped while a reader
+// copies entries out rather than blocking the sampler.
+void power_history_add(int64_t now, float power);
+
+// Finest resolution (seconds) whose tier still covers from, the coarsest one otherwise
+uint32_t power_history_resolution(uint32_t from);
+
+// Copy up to *count entries of the tier with resolution res, oldest first, from the first
+// one that starts at or after *from. On return *count is the number copied (0 at the end),
+// *time the start in seconds since boot of the first one and *from the start of the entry
+// after the last one, so repeated calls read the tier in bounded batches.
+// Returns ESP_ERR_NOT_FOUND when no tier has that resolution.
+esp_err_t power_history_read(uint32_t res, uint32_t *from, power_history_entry_t *entries,
+                             size_t *count, uint32_t *time);
+
+#endif // POWER_HISTORY_H
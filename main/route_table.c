@@ -0,0 +1,183 @@
+#include "route_table.h"
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Seeds tried before giving up, a seed only fails when a bucket cannot be placed at all
+#define ROUTE_TABLE_SEED_TRIES 64
+// Buckets hold about two keys, a seed putting more than this in one is skipped
+#define ROUTE_TABLE_MAX_BUCKET 8
+
+// FNV-1a over the method and the uri, with the seed mixed into the offset basis, then the
+// murmur3 finalizer so every bit depends on every byte
+static uint32_t route_hash(uint32_t seed, action_method_t method, const char *uri, size_t len) {
+    uint32_t h = 2166136261u ^ seed;
+
+    h = (h ^ (uint8_t)method) * 16777619u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)uri[i]) * 16777619u;
+    }
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    return h ^ (h >> 16);
+}
+
+// Buckets come from the low bits, the slot from the high ones. The step is odd, so the
+// displacements 0..mask of a bucket visit every slot once.
+static inline uint32_t route_bucket(const route_table_t *table, uint32_t h) {
+    return h & table->bucket_mask;
+}
+
+static inline uint32_t route_slot(const route_table_t *table, uint32_t h, uint32_t displacement) {
+    uint32_t step = ((h * 0x9e3779b9u) >> 16) | 1;
+    return ((h >> 12) + displacement * step) & table->mask;
+}
+
+static bool route_equal(const device_endpoint_t *endpoint, action_method_t method, const char *uri, size_t len) {
+    return endpoint->method == method && strncmp(endpoint->uri, uri, len) == 0 && endpoint->uri[len] == '\0';
+}
+
+static uint32_t endpoint_hash(uint32_t seed, const device_endpoint_t *endpoint) {
+    return route_hash(seed, endpoint->method, endpoint->uri, strlen(endpoint->uri));
+}
+
+// Place the keys of every bucket, largest buckets first. first/next chain the endpoints of
+// each bucket, hashes holds their hash for the seed. Returns false when a bucket fits nowhere.
+static bool route_place(route_table_t *table, const uint32_t *hashes, const int *first,
+                        const int *next, int max_bucket) {
+    uint32_t slots[ROUTE_TABLE_MAX_BUCKET];
+
+    memset(table->slots, 0, (table->mask + 1) * sizeof(table->slots[0]));
+    memset(table->displacements, 0, (table->bucket_mask + 1) * sizeof(table->displacements[0]));
+    for (int size = max_bucket; size > 0; size--) {
+        for (uint32_t b = 0; b <= table->bucket_mask; b++) {
+            int count = 0;
+            for (int i = first[b]; i >= 0; i = next[i]) {
+                count++;
+            }
+            if (count != size) {
+                continue;
+            }
+            uint32_t d;
+            for (d = 0; d <= table->mask; d++) {
+                int n = 0;
+                int i;
+                for (i = first[b]; i >= 0; i = next[i], n++) {
+                    uint32_t slot = route_slot(table, hashes[i], d);
+                    int k;
+                    for (k = 0; k < n && slots[k] != slot; k++) {
+                    }
+                    if (table->slots[slot] != 0 || k < n) {
+                        break;
+                    }
+                    slots[n] = slot;
+                }
+                if (i < 0) {
+                    break;
+                }
+            }
+            if (d > table->mask) {
+                return false;
+            }
+            table->displacements[b] = d;
+            int n = 0;
+            for (int i = first[b]; i >= 0; i = next[i]) {
+                table->slots[slots[n++]] = i + 1;
+            }
+        }
+    }
+    return true;
+}
+
+// Try seeds until every bucket is placed, with the scratch arrays of route_table_build
+static esp_err_t route_search(route_table_t *table, int num_endpoints, uint32_t *hashes, int *first, int *next) {
+    const device_endpoint_t *endpoints = table->endpoints;
+
+    for (uint32_t seed = 0; seed < ROUTE_TABLE_SEED_TRIES; seed++) {
+        int max_bucket = 0;
+        for (uint32_t b = 0; b <= table->bucket_mask; b++) {
+            first[b] = -1;
+        }
+        for (int i = 0; i < num_endpoints; i++) {
+            hashes[i] = endpoint_hash(seed, &endpoints[i]);
+            uint32_t b = route_bucket(table, hashes[i]);
+            int size = 1;
+            // Equal routes always share a bucket, so duplicates are found within it
+            for (int j = first[b]; j >= 0; j = next[j], size++) {
+                if (hashes[j] == hashes[i] && endpoints[j].method == endpoints[i].method &&
+                    strcmp(endpoints[j].uri, endpoints[i].uri) == 0) {
+                    return ESP_ERR_INVALID_ARG;
+                }
+            }
+            next[i] = first[b];
+            first[b] = i;
+            if (size > max_bucket) {
+                max_bucket = size;
+            }
+        }
+        if (max_bucket <= ROUTE_TABLE_MAX_BUCKET && route_place(table, hashes, first, next, max_bucket)) {
+            table->seed = seed;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_SIZE;
+}
+
+esp_err_t route_table_build(route_table_t *table, const device_endpoint_t *endpoints, int num_endpoints) {
+    if (num_endpoints < 0 || num_endpoints > ROUTE_TABLE_MAX_ENDPOINTS) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t slots = 2;
+    while (slots < 2 * (uint32_t)num_endpoints) {
+        slots *= 2;
+    }
+    uint32_t buckets = slots / 4 > 0 ? slots / 4 : 1;
+    route_table_free(table);
+    table->endpoints = endpoints;
+    table->mask = slots - 1;
+    table->bucket_mask = buckets - 1;
+    table->slots = calloc(slots, sizeof(table->slots[0]));
+    table->displacements = calloc(buckets, sizeof(table->displacements[0]));
+    // Scratch for the search: the hash of each endpoint and the chain of each bucket
+    uint32_t *hashes = malloc((num_endpoints + 1) * sizeof(uint32_t));
+    int *first = malloc(buckets * sizeof(int));
+    int *next = malloc((num_endpoints + 1) * sizeof(int));
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    if (table->slots != NULL && table->displacements != NULL && hashes != NULL && first != NULL && next != NULL) {
+        err = route_search(table, num_endpoints, hashes, first, next);
+    }
+    free(hashes);
+    free(first);
+    free(next);
+    if (err != ESP_OK) {
+        route_table_free(table);
+    }
+    return err;
+}
+
+void route_table_free(route_table_t *table) {
+    free(table->slots);
+    free(table->displacements);
+    table->slots = NULL;
+    table->displacements = NULL;
+    table->mask = 0;
+    table->bucket_mask = 0;
+}
+
+const device_endpoint_t *route_table_lookup(const route_table_t *table, action_method_t method,
+                                            const char *uri, size_t len) {
+    if (table->slots == NULL) {
+        return NULL;
+    }
+    uint32_t h = route_hash(table->seed, method, uri, len);
+    uint16_t index = table->slots[route_slot(table, h, table->displacements[route_bucket(table, h)])];
+    if (index == 0) {
+        return NULL;
+    }
+    const device_endpoint_t *endpoint = &table->endpoints[index - 1];
+    return route_equal(endpoint, method, uri, len) ? endpoint : NULL;
+}
@@ -0,0 +1,39 @@
+#ifndef ROUTE_TABLE_H
+#define ROUTE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "device_actions.h"
+
+// Largest number of endpoints, slot indices and displacements are stored in 16 bits
+#define ROUTE_TABLE_MAX_ENDPOINTS 4096
+
+// Perfect hash from (method, uri) to an endpoint, built once from a const endpoint array.
+// The hash of a key picks a bucket of about two keys, and the displacement of that bucket
+// moves its keys to free slots (hash and displace). Every endpoint has its own slot, so a
+// lookup hashes the key once and compares one entry. The arrays are allocated by
+// route_table_build, sized from the endpoint count.
+typedef struct {
+    const device_endpoint_t *endpoints;
+    uint32_t seed;
+    uint32_t mask;              // Number of slots - 1, a power of two at least twice the endpoints
+    uint32_t bucket_mask;       // Number of buckets - 1
+    uint16_t *displacements;    // One per bucket
+    uint16_t *slots;            // Endpoint index + 1, 0 when empty
+} route_table_t;
+
+// Find displacements for which no two endpoints share a slot. table must be zeroed or
+// previously built, its arrays are reused or reallocated.
+// Returns ESP_ERR_INVALID_ARG for duplicate routes, ESP_ERR_NO_MEM when the arrays cannot
+// be allocated and ESP_ERR_INVALID_SIZE when there are too many endpoints or no seed was found.
+esp_err_t route_table_build(route_table_t *table, const device_endpoint_t *endpoints, int num_endpoints);
+
+// Release the arrays of a built table
+void route_table_free(route_table_t *table);
+
+// uri is len bytes long and need not be NUL terminated. Returns NULL when there is no route.
+const device_endpoint_t *route_table_lookup(const route_table_t *table, action_method_t method,
+                                            const char *uri, size_t len);
+
+#endif // ROUTE_TABLE_H
@@ -1,8 +1,16 @@
 #include "device_actions.h"
+#include "device_batch.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "hlw8012.h"
-#include <string.h>
+#include "json_reader.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "power_history.h"
+#include "plug_telemetry.h"
+#include "web_server.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 #define PLUG_PIN GPIO_NUM_5
 #define HLW8012_SEL_PIN GPIO_NUM_12
@@ -11,47 +19,171 @@
 static const char *TAG = "smart_plug";
 static int plug_state = 0;
 
-static action_response_t handle_get_state(const cJSON *request) {
-    action_response_t response = {0};
-    cJSON *root = cJSON_CreateObject();
-    hlw8012_readings_t readings = {0};  // Initialize to zeros
+#ifdef CONFIG_PLUG_SAMPLE_PERIOD_MS
+#define PLUG_SAMPLE_PERIOD_MS CONFIG_PLUG_SAMPLE_PERIOD_MS
+#else
+#define PLUG_SAMPLE_PERIOD_MS 500
+#endif
+// Below the HTTP server, above the benchmark
+#define PLUG_SAMPLER_PRIORITY (tskIDLE_PRIORITY + 2)
+#define PLUG_SAMPLER_STACK 2048
+
+// Latest sensor readings, published by the sampler task
+typedef struct {
+    hlw8012_readings_t readings;
+    int64_t timestamp;          // esp_timer time of the sample, 0 before the first one
+} plug_sample_t;
+
+static plug_sample_t plug_sample;
+
+// The energy counter is saved at most every PLUG_ENERGY_SAVE_MINUTES and only when it
+// changed, so an idle plug does not wear the flash and a power cut loses one interval
+#ifdef CONFIG_PLUG_ENERGY_SAVE_MINUTES
+#define PLUG_ENERGY_SAVE_MINUTES CONFIG_PLUG_ENERGY_SAVE_MINUTES
+#else
+#define PLUG_ENERGY_SAVE_MINUTES 15
+#endif
+#define PLUG_NAMESPACE "plug"
+#define PLUG_ENERGY_KEY "energy_uws"
+
+static uint64_t saved_energy_uws = 0;
+static int64_t energy_saved_at = 0;
+
+static uint64_t plug_energy_load(void) {
+    nvs_handle handle;
+    uint64_t energy = 0;
+
+    if (nvs_open(PLUG_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u64(handle, PLUG_ENERGY_KEY, &energy);
+        nvs_close(handle);
+    }
+    return energy;
+}
+
+static void plug_energy_save(uint64_t energy, int64_t now) {
+    nvs_handle handle;
+
+    if (energy == saved_energy_uws ||
+        now - energy_saved_at < PLUG_ENERGY_SAVE_MINUTES * 60 * 1000000LL) {
+        return;
+    }
+    esp_err_t err = nvs_open(PLUG_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u64(handle, PLUG_ENERGY_KEY, energy);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err == ESP_OK) {
+        saved_energy_uws = energy;
+    } else {
+        ESP_LOGW(TAG, "Failed to save energy: %s", esp_err_to_name(err));
+    }
+    // Retry after a full interval on failure too
+    energy_saved_at = now;
+}
+
+// Snapshots the readings the HLW8012 driver computes every gate window
+static void plug_sampler_task(void *pvParameters) {
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        hlw8012_readings_t readings = {0};
+        esp_err_t ret = hlw8012_get_readings(&readings);
+        if (ret == ESP_OK) {
+            int64_t now = esp_timer_get_time();
+            taskENTER_CRITICAL();
+            plug_sample.readings = readings;
+            plug_sample.timestamp = now;
+            taskEXIT_CRITICAL();
+            power_history_add(now, readings.power);
+            plug_energy_save(readings.energy_uws, now);
+        } else {
+            ESP_LOGW(TAG, "HLW8012 read failed: %d", ret);
+        }
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(PLUG_SAMPLE_PERIOD_MS));
+    }
+}
+
+static esp_err_t handle_get_state(const action_request_t *request, json_writer_t *response) {
+    plug_sample_t sample;
     
-    // Add basic state
-    cJSON_AddNumberToObject(root, "state", plug_state);
+    // Copy the snapshot, readings are zeros until the first sample
+    taskENTER_CRITICAL();
+    sample = plug_sample;
+    taskEXIT_CRITICAL();
     
-    // Always add power readings, even if zero
-    esp_err_t ret = hlw8012_get_readings(&readings);
-    if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "HLW8012 read failed: %d, returning zeros", ret);
-        // readings struct already initialized to zeros
+    plug_telemetry_t telemetry = {
+        .state = plug_state,
+        .voltage = sample.readings.voltage,
+        .current = sample.readings.current,
+        .power = sample.readings.power,
+        .energy_uws = sample.readings.energy_uws,
+        .sample_age_ms = sample.timestamp > 0 ? (esp_timer_get_time() - sample.timestamp) / 1000 : -1,
+    };
+    if (request->format == ACTION_FORMAT_BINARY) {
+        uint8_t buf[PLUG_TELEMETRY_BINARY_SIZE];
+        plug_telemetry_encode(&telemetry, buf);
+        json_raw(response, buf, sizeof(buf));
+    } else {
+        plug_telemetry_write_json(response, &telemetry);
     }
+    return ESP_OK;
+}
+
+// The relay is the only output
+static void plug_set_output(int output, int state) {
+    plug_state = state;
+    gpio_set_level(PLUG_PIN, plug_state);
+}
+
+static esp_err_t handle_put_state(const action_request_t *request, json_writer_t *response) {
+    int32_t state;
+    const json_field_t fields[] = {
+        { .key = "state", .type = JSON_FIELD_INT, .value = &state, .min = 0, .max = 1, .required = true },
+    };
     
-    // Always include these fields
-    cJSON_AddNumberToObject(root, "voltage", readings.voltage);
-    cJSON_AddNumberToObject(root, "current", readings.current);
-    cJSON_AddNumberToObject(root, "power", readings.power);
-    cJSON_AddNumberToObject(root, "energy", readings.energy);
+    if (request->body == NULL ||
+        json_parse_object(request->body, request->body_len, fields, sizeof(fields) / sizeof(fields[0]), NULL) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    plug_set_output(0, state);
+    xSemaphoreGive(mutex);
     
-    response.response = cJSON_Print(root);
-    response.status = ESP_OK;
-    cJSON_Delete(root);
-    return response;
+    json_obj_begin(response, NULL);
+    json_int(response, "state", state);
+    json_obj_end(response);
+    return ESP_OK;
 }
 
-static action_response_t handle_put_state(const cJSON *request) {
-    action_response_t response = {0};
-    cJSON *state_item = cJSON_GetObjectItem(request, "state");
-    
-    if (cJSON_IsNumber(state_item)) {
-        plug_state = state_item->valueint;
-        gpio_set_level(PLUG_PIN, plug_state);
-        response.status = ESP_OK;
-        response.response = strdup("State updated");
-    } else {
-        response.status = ESP_ERR_INVALID_ARG;
-        response.response = strdup("Invalid state value");
+static int plug_get_state(void) {
+    return plug_state;
+}
+
+static int plug_get_output(int output) {
+    return plug_state;
+}
+
+static bool plug_get_power(float *watts) {
+    hlw8012_readings_t readings;
+
+    if (hlw8012_get_readings(&readings) != ESP_OK) {
+        return false;
     }
-    return response;
+    *watts = readings.power;
+    return true;
+}
+
+static bool plug_get_energy(uint64_t *energy_uws) {
+    hlw8012_readings_t readings;
+
+    if (hlw8012_get_readings(&readings) != ESP_OK) {
+        return false;
+    }
+    *energy_uws = readings.energy_uws;
+    return true;
 }
 
 static esp_err_t plug_init(void) {
@@ -73,8 +205,26 @@ static esp_err_t plug_init(void) {
         .current_multiplier = 0.001,  // Adjust based on calibration
         .voltage_multiplier = 0.4,    // Adjust based on calibration
         .power_multiplier = 0.2,      // Adjust based on calibration
+        .gate_ms = HLW8012_DEFAULT_GATE_MS,
     };
-    return hlw8012_init(&hlw_config);
+    if (power_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Power history disabled");
+    }
+    
+    // Continue counting from the last saved energy, before the driver starts counting
+    saved_energy_uws = plug_energy_load();
+    energy_saved_at = esp_timer_get_time();
+    hlw8012_set_energy(saved_energy_uws);
+    esp_err_t ret = hlw8012_init(&hlw_config);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    
+    if (xTaskCreate(plug_sampler_task, "plug_sampler", PLUG_SAMPLER_STACK, NULL,
+                    PLUG_SAMPLER_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
 
 
@@ -83,7 +233,8 @@ static const device_endpoint_t plug_endpoints[] = {
         .uri = "/state",
         .method = ACTION_GET,
         .handler = handle_get_state,
-        .description = "Get plug state"
+        .description = "Get plug state",
+        .binary = true
     },
     {
         .uri = "/state",
@@ -91,12 +242,24 @@ static const device_endpoint_t plug_endpoints[] = {
         .handler = handle_put_state,
         .description = "Set plug state"
     },
+    {
+        .uri = "/batch",
+        .method = ACTION_POST,
+        .handler = device_batch_handler,
+        .description = "Apply several state changes at once"
+    },
 };
 
 const device_config_t DEVICE_CONFIG = {
-    .device_type = "smart_plug",
+    .device_type = "plug",
     .endpoints = plug_endpoints,
     .num_endpoints = sizeof(plug_endpoints) / sizeof(plug_endpoints[0]),
     .init = plug_init,
-    .deinit = NULL
+    .deinit = NULL,
+    .get_state = plug_get_state,
+    .num_outputs = 1,
+    .get_output = plug_get_output,
+    .set_output = plug_set_output,
+    .get_power = plug_get_power,
+    .get_energy = plug_get_energy
 };
@@ -2,12 +2,24 @@
 #include "esp_log.h"
 #include "esp_wifi.h"
 #include "core_main.h"
+#include "benchmark_history.h"
+#include "load_generator.h"
+#include "benchmark_sweep.h"
+#include "benchmark_energy.h"
+#include "json_writer.h"
+#include "json_reader.h"
+#include "route_table.h"
+#include "power_history.h"
+#include "esp_system.h"
+#include "esp_clk.h"
 #include "nvs_flash.h"
 #include "freertos/task.h"
 #include "esp_http_server.h"
 #include "esp_timer.h"
-#include "cJSON.h"
 #include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
 #include "esp_http_client.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -15,12 +27,180 @@
 
 static const char *TAG = "smart_plug_proxy";
 
+// Status information
+static const char *firmware_version = "1.0.0";
+
+// Response buffer shared by all handlers, the server task handles one request at a time.
+// Larger responses are streamed with chunked transfer encoding.
+#define RESPONSE_BUF_SIZE 512
+static char response_buf[RESPONSE_BUF_SIZE];
+
+// Keep-alive sessions. The few sockets the plug can afford are shared by LRU purge when
+// a new client connects, and connections idle for KEEPALIVE_IDLE_SECS are closed so a
+// silent client does not hold one until then.
+#define HTTP_MAX_SESSIONS 4
+#define KEEPALIVE_IDLE_SECS 10
+#define KEEPALIVE_SWEEP_MS 2000
+
+typedef struct {
+    int fd;                     // -1 when the slot is free
+    int64_t last_used;          // esp_timer time of the last response
+    uint32_t requests;          // Requests served on this connection
+    bool closing;               // Idle close requested
+} http_session_t;
+
+typedef struct {
+    uint32_t connections;       // Connections that served at least one request
+    uint32_t requests;
+    uint32_t reused;            // Requests served on an already used connection
+    uint32_t idle_closed;
+} http_session_stats_t;
+
+// Only touched from the server task (handlers, session free and queued work)
+static http_session_t sessions[HTTP_MAX_SESSIONS];
+static http_session_stats_t session_stats;
+static httpd_handle_t session_server = NULL;
+static esp_timer_handle_t session_sweep_timer = NULL;
+
+static void http_session_free(void *ctx) {
+    http_session_t *session = (http_session_t *)ctx;
+    session->fd = -1;
+}
+
+// Account a request to the session of its connection
+static void http_session_touch(httpd_req_t *req) {
+    http_session_t *session = (http_session_t *)req->sess_ctx;
+
+    if (session == NULL) {
+        for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+            if (sessions[i].fd < 0) {
+                session = &sessions[i];
+                session->fd = httpd_req_to_sockfd(req);
+                session->requests = 0;
+                session->closing = false;
+                req->sess_ctx = session;
+                req->free_ctx = http_session_free;
+                session_stats.connections++;
+                break;
+            }
+        }
+    }
+    session_stats.requests++;
+    if (session != NULL) {
+        if (session->requests > 0) {
+            session_stats.reused++;
+        }
+        session->requests++;
+        session->last_used = esp_timer_get_time();
+    }
+}
+
+// Runs on the server task, closes the sessions idle for too long
+static void http_session_sweep(void *arg) {
+    int64_t now = esp_timer_get_time();
+
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        http_session_t *session = &sessions[i];
+        if (session->fd >= 0 && !session->closing &&
+            now - session->last_used > (int64_t)KEEPALIVE_IDLE_SECS * 1000000) {
+            session->closing = true;
+            session_stats.idle_closed++;
+            httpd_sess_trigger_close(session_server, session->fd);
+        }
+    }
+}
+
+static void http_session_sweep_timer_callback(void *arg) {
+    if (session_server != NULL) {
+        httpd_queue_work(session_server, http_session_sweep, NULL);
+    }
+}
+
+typedef struct {
+    httpd_req_t *req;
+    json_writer_t writer;
+    bool chunked;               // Part of the body was already sent as a chunk
+} json_response_t;
+
+static esp_err_t json_response_flush(void *ctx, const char *data, size_t len) {
+    json_response_t *resp = (json_response_t *)ctx;
+    resp->chunked = true;
+    return httpd_resp_send_chunk(resp->req, data, len);
+}
+
+// Set the JSON response headers and return the writer for the body
+static json_writer_t *json_response_begin(json_response_t *resp, httpd_req_t *req) {
+    resp->req = req;
+    resp->chunked = false;
+    http_session_touch(req);
+    httpd_resp_set_type(req, "application/json");
+    json_writer_init(&resp->writer, response_buf, sizeof(response_buf), json_response_flush, resp);
+    return &resp->writer;
+}
+
+// Send the body, in one piece with a Content-Length when it fit in the buffer
+static esp_err_t json_response_end(json_response_t *resp) {
+    if (!resp->chunked) {
+        return httpd_resp_send(resp->req, resp->writer.buf, resp->writer.len);
+    }
+    esp_err_t err = json_writer_flush(&resp->writer);
+    if (err == ESP_OK) {
+        err = httpd_resp_send_chunk(resp->req, NULL, 0);
+    }
+    return err;
+}
+
+#define BINARY_CONTENT_TYPE "application/octet-stream"
+
+// True when the Accept header lists application/octet-stream. Only the start of a long
+// header is looked at.
+static bool request_accepts_binary(httpd_req_t *req) {
+    char accept[64];
+
+    esp_err_t err = httpd_req_get_hdr_value_str(req, "Accept", accept, sizeof(accept));
+    return (err == ESP_OK || err == ESP_ERR_HTTPD_RESULT_TRUNC) &&
+           strstr(accept, BINARY_CONTENT_TYPE) != NULL;
+}
+
+// Plain run, run under HTTP load (see load_generator.h), one run per CPU clock
+// (see benchmark_sweep.h) or plain run with its power sampled (see benchmark_energy.h)
+typedef enum {
+    BENCHMARK_MODE_NORMAL,
+    BENCHMARK_MODE_INTERFERENCE,
+    BENCHMARK_MODE_SWEEP,
+    BENCHMARK_MODE_ENERGY
+} benchmark_mode_t;
+
+static const char *benchmark_mode_names[] = {
+    [BENCHMARK_MODE_NORMAL] = "normal",
+    [BENCHMARK_MODE_INTERFERENCE] = "interference",
+    [BENCHMARK_MODE_SWEEP] = "sweep",
+    [BENCHMARK_MODE_ENERGY] = "energy",
+};
+
+// Port of the server, host builds pick another one than 80
+#ifndef WEB_SERVER_PORT
+#define WEB_SERVER_PORT 80
+#endif
+#define PORT_STR(port) #port
+#define PORT_URL(port, path) "http://127.0.0.1:" PORT_STR(port) path
+
+#define INTERFERENCE_DEFAULT_RATE 10
+#define INTERFERENCE_URL PORT_URL(WEB_SERVER_PORT, "/plug/state")
+
 // Structure to hold benchmark results
 typedef struct {
-    int iterations_per_sec;
-    float total_time;
-    int error_count;
+    coremark_result_t result;
+    bool has_result;
     bool is_running;
+    benchmark_mode_t mode;
+    uint32_t rate;                      // Load rate requested for BENCHMARK_MODE_INTERFERENCE
+    coremark_result_t baseline;         // Idle run preceding the loaded one
+    load_generator_stats_t load;
+    uint32_t sweep_freqs[BENCHMARK_SWEEP_MAX_POINTS];   // Clocks of BENCHMARK_MODE_SWEEP (MHz)
+    int sweep_count;
+    benchmark_sweep_point_t sweep[BENCHMARK_SWEEP_MAX_POINTS];
+    benchmark_energy_t energy;          // Power of a BENCHMARK_MODE_ENERGY run
 } benchmark_result_t;
 
 // Shared benchmark state
@@ -29,8 +209,63 @@ static benchmark_result_t benchmark_state = {
 };
 static SemaphoreHandle_t benchmark_mutex = NULL;
 
+// Recent per-chunk progress of the running benchmark, oldest entries are overwritten
+#define PROGRESS_RING_SIZE 16
+
+typedef struct {
+    uint32_t seq;
+    coremark_progress_t progress;
+} progress_entry_t;
+
+static progress_entry_t progress_ring[PROGRESS_RING_SIZE];
+static uint32_t progress_seq = 0;           // Sequence number of the last entry, 0 if none
+
+// Called by coremark_main after every chunk
+static void benchmark_progress_cb(const coremark_progress_t *progress, void *arg) {
+    xSemaphoreTake(benchmark_mutex, portMAX_DELAY);
+    progress_seq++;
+    progress_ring[progress_seq % PROGRESS_RING_SIZE].seq = progress_seq;
+    progress_ring[progress_seq % PROGRESS_RING_SIZE].progress = *progress;
+    xSemaphoreGive(benchmark_mutex);
+}
+
+// State of the device, written back by the interference load
+static int get_plug_state(void) {
+    return DEVICE_CONFIG.get_state != NULL ? DEVICE_CONFIG.get_state() : 0;
+}
+
+// Record a finished run at cpu_mhz in the NVS history
+static void benchmark_record_run(float iterations_per_sec, uint32_t iterations, bool valid, uint32_t cpu_mhz) {
+    benchmark_record_t record = {
+        .timestamp = time(NULL),
+        .boot_count = benchmark_history_boot_count(),
+        .iterations_per_sec = iterations_per_sec,
+        .iterations = iterations,
+        .free_heap = esp_get_free_heap_size(),
+        .cpu_freq_mhz = cpu_mhz,
+        .plug_state = get_plug_state(),
+        .valid = valid,
+    };
+    snprintf(record.firmware, sizeof(record.firmware), "%s", firmware_version);
+    benchmark_history_add(&record);
+}
+
 // Forward declaration and implementation of benchmark task
 static void benchmark_task(void *pvParameters) {
+    static coremark_result_t result;
+    static coremark_result_t baseline;
+    static benchmark_sweep_point_t sweep[BENCHMARK_SWEEP_MAX_POINTS];
+    load_generator_stats_t load = {0};
+    benchmark_energy_t energy = {0};
+
+    xSemaphoreTake(benchmark_mutex, portMAX_DELAY);
+    benchmark_mode_t mode = benchmark_state.mode;
+    uint32_t rate = benchmark_state.rate;
+    uint32_t sweep_freqs[BENCHMARK_SWEEP_MAX_POINTS];
+    int sweep_count = benchmark_state.sweep_count;
+    memcpy(sweep_freqs, benchmark_state.sweep_freqs, sizeof(sweep_freqs));
+    xSemaphoreGive(benchmark_mutex);
+
     ee_printf("Starting CoreMark benchmark...\n");
     
     // Set to low but not lowest priority
@@ -38,20 +273,209 @@ static void benchmark_task(void *pvParameters) {
     // Short delay to let system stabilize
     vTaskDelay(pdMS_TO_TICKS(50));
     
-    int64_t start_time = esp_timer_get_time();
-    int error_count = coremark_main();
-    float total_time = (esp_timer_get_time() - start_time) / 1000000.0;
+    coremark_set_progress_cb(benchmark_progress_cb, NULL);
+    if (mode == BENCHMARK_MODE_INTERFERENCE) {
+        // Idle baseline first, then the same run with the control plane loaded
+        coremark_main(&baseline);
+        if (load_generator_start(INTERFERENCE_URL, rate, get_plug_state) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start load generator");
+        }
+        coremark_main(&result);
+        load_generator_stop(&load);
+        ee_printf("Load requests    : %u, %u failed\n", (unsigned)load.requests, (unsigned)load.failures);
+        if (!load_generator_ok(&load)) {
+            // Without loopback in lwIP (CONFIG_LWIP_NETIF_LOOPBACK) every request fails
+            ESP_LOGE(TAG, "The load did not reach %s, the loaded run is not under load", INTERFERENCE_URL);
+        }
+    } else if (mode == BENCHMARK_MODE_SWEEP) {
+        benchmark_sweep_run(sweep_freqs, sweep_count, DEVICE_CONFIG.get_power, DEVICE_CONFIG.get_energy, sweep);
+    } else if (mode == BENCHMARK_MODE_ENERGY) {
+        esp_err_t err = benchmark_energy_start(DEVICE_CONFIG.get_power, DEVICE_CONFIG.get_energy);
+        coremark_main(&result);
+        if (err == ESP_OK) {
+            err = benchmark_energy_stop(result.iterations_per_sec, &energy);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Power sampling failed: %s", esp_err_to_name(err));
+        }
+        if (err == ESP_OK && !isnan(energy.joules_per_kiloiteration)) {
+            ee_printf("Mean power (W)   : %f\n", energy.mean_power);
+            ee_printf("J/1000 iterations: %f\n", energy.joules_per_kiloiteration);
+            ee_printf("Iterations/W     : %f\n", energy.iterations_per_watt);
+        } else {
+            ee_printf("Mean power (W)   : n/a\n");
+        }
+    } else {
+        coremark_main(&result);
+    }
+    coremark_set_progress_cb(NULL, NULL);
     
     xSemaphoreTake(benchmark_mutex, portMAX_DELAY);
-    benchmark_state.error_count = error_count;
-    benchmark_state.total_time = total_time;
-    benchmark_state.iterations_per_sec = (total_time > 0) ? (1000 / total_time) : 0;
+    benchmark_state.baseline = baseline;
+    benchmark_state.load = load;
+    benchmark_state.result = result;
+    benchmark_state.energy = energy;
+    memcpy(benchmark_state.sweep, sweep, sizeof(sweep));
+    benchmark_state.has_result = true;
     benchmark_state.is_running = false;
     xSemaphoreGive(benchmark_mutex);
+
+    // Loaded scores would read as regressions in the history, sampling the power does not
+    // disturb the run
+    if (mode == BENCHMARK_MODE_NORMAL || mode == BENCHMARK_MODE_ENERGY) {
+        benchmark_record_run(result.iterations_per_sec, result.iterations, result.valid,
+                             esp_clk_cpu_freq() / 1000000);
+    } else if (mode == BENCHMARK_MODE_SWEEP) {
+        for (int i = 0; i < sweep_count; i++) {
+            if (sweep[i].err == ESP_OK) {
+                benchmark_record_run(sweep[i].iterations_per_sec, sweep[i].iterations, sweep[i].valid,
+                                     sweep[i].cpu_mhz);
+            }
+        }
+    }
     
     vTaskDelete(NULL);
 }
 
+// Add a per-context array of crcs to a JSON object
+static void add_crc_array(json_writer_t *w, const char *name, const ee_u16 *crcs, ee_u32 contexts) {
+    json_arr_begin(w, name);
+    for (ee_u32 i = 0; i < contexts; i++) {
+        json_uint(w, NULL, crcs[i]);
+    }
+    json_arr_end(w);
+}
+
+#if CORE_PROFILE
+// Cycles spent in each kernel, see CONFIG_COREMARK_PROFILE_KERNELS
+static void add_kernel_profile(json_writer_t *w, const coremark_result_t *result) {
+    static const char *names[NUM_ALGORITHMS] = {
+        [KERNEL_LIST] = "list",
+        [KERNEL_MATRIX] = "matrix",
+        [KERNEL_STATE] = "state",
+    };
+    CORE_TICKS all = 0;
+
+    for (int i = 0; i < NUM_ALGORITHMS; i++) {
+        all += result->kernel_cycles[i];
+    }
+    json_obj_begin(w, "kernels");
+    for (int i = 0; i < NUM_ALGORITHMS; i++) {
+        json_obj_begin(w, names[i]);
+        json_int(w, "cycles", result->kernel_cycles[i]);
+        json_double(w, "cycles_per_iteration", result->iterations > 0 ?
+            (double)result->kernel_cycles[i] / result->iterations : 0);
+        json_double(w, "share", all > 0 ? (double)result->kernel_cycles[i] / all : 0);
+        json_obj_end(w);
+    }
+    json_obj_end(w);
+}
+#endif
+
+// Serialize a coremark_result_t as returned by /benchmark/results
+static void add_benchmark_result(json_writer_t *w, const coremark_result_t *result) {
+    json_double(w, "iterations_per_sec", result->iterations_per_sec);
+    json_double(w, "coremark_per_mhz", result->coremark_per_mhz);
+    json_double(w, "cpu_mhz", result->cpu_mhz);
+    json_str(w, "timer", result->timer);
+    json_uint(w, "iterations", result->iterations);
+    json_uint(w, "contexts", result->contexts);
+    json_uint(w, "size", result->size);
+    json_uint(w, "data_size", result->data_size);
+    json_arr_begin(w, "seeds");
+    json_int(w, NULL, result->seed1);
+    json_int(w, NULL, result->seed2);
+    json_int(w, NULL, result->seed3);
+    json_arr_end(w);
+    json_uint(w, "algorithms", result->execs);
+    json_int(w, "ticks", result->ticks);
+    json_double(w, "total_time_seconds", result->total_secs);
+    json_double(w, "wall_time_seconds", result->wall_secs);
+    json_int(w, "error_count", result->errors);
+    json_bool(w, "valid", result->valid);
+    json_int(w, "known_id", result->known_id);
+    json_str(w, "profile", result->profile);
+    json_uint(w, "seedcrc", result->seedcrc);
+    add_crc_array(w, "crclist", result->crclist, result->contexts);
+    add_crc_array(w, "crcmatrix", result->crcmatrix, result->contexts);
+    add_crc_array(w, "crcstate", result->crcstate, result->contexts);
+    add_crc_array(w, "crcfinal", result->crcfinal, result->contexts);
+    if (result->calibration.iterations > 0) {
+        json_obj_begin(w, "calibration");
+        json_double(w, "target_seconds", result->calibration.target_secs);
+        json_uint(w, "probes", result->calibration.probes);
+        json_uint(w, "probe_iterations", result->calibration.probe_iterations);
+        json_int(w, "probe_ticks", result->calibration.probe_ticks);
+        json_double(w, "seconds_per_iteration", result->calibration.secs_per_iteration);
+        json_double(w, "overhead_seconds", result->calibration.overhead_secs);
+        json_double(w, "spread", result->calibration.spread);
+        json_obj_end(w);
+    }
+#if CORE_PROFILE
+    add_kernel_profile(w, result);
+#endif
+}
+
+// Serialize the idle vs loaded comparison of an interference run
+static void add_interference_result(json_writer_t *w, const coremark_result_t *baseline,
+                                    const coremark_result_t *loaded, const load_generator_stats_t *load) {
+    json_obj_begin(w, "interference");
+    json_double(w, "baseline_iterations_per_sec", baseline->iterations_per_sec);
+    json_double(w, "loaded_iterations_per_sec", loaded->iterations_per_sec);
+    json_double(w, "delta_percent", baseline->iterations_per_sec > 0 ?
+        100.0 * (loaded->iterations_per_sec - baseline->iterations_per_sec) / baseline->iterations_per_sec : 0);
+    json_uint(w, "rate", load->rate);
+    json_double(w, "achieved_rate", load->achieved_rate);
+    json_uint(w, "requests", load->requests);
+    json_uint(w, "failures", load->failures);
+    json_bool(w, "load_ok", load_generator_ok(load));
+    json_obj_begin(w, "latency_us");
+    json_uint(w, "p50", load->p50_us);
+    json_uint(w, "p90", load->p90_us);
+    json_uint(w, "p99", load->p99_us);
+    json_uint(w, "max", load->max_us);
+    json_obj_end(w);
+    json_obj_end(w);
+}
+
+// Serialize the points of a sweep run, the power figures are null without an energy meter
+static void add_sweep_result(json_writer_t *w, const benchmark_sweep_point_t *points, int count) {
+    json_str(w, "compiler_flags", COMPILER_FLAGS);
+    json_arr_begin(w, "sweep");
+    for (int i = 0; i < count; i++) {
+        const benchmark_sweep_point_t *p = &points[i];
+        json_obj_begin(w, NULL);
+        json_uint(w, "cpu_mhz", p->cpu_mhz);
+        if (p->err != ESP_OK) {
+            json_str(w, "error", esp_err_to_name(p->err));
+            json_obj_end(w);
+            continue;
+        }
+        json_double(w, "iterations_per_sec", p->iterations_per_sec);
+        json_double(w, "coremark_per_mhz", p->coremark_per_mhz);
+        json_uint(w, "iterations", p->iterations);
+        json_bool(w, "valid", p->valid);
+        json_double(w, "mean_power_w", p->mean_power);
+        json_double(w, "energy_per_iteration_uj", p->energy_per_iteration);
+        json_obj_end(w);
+    }
+    json_arr_end(w);
+}
+
+// Serialize the power of an energy run, the figures are null without a power meter
+static void add_energy_result(json_writer_t *w, const benchmark_energy_t *energy) {
+    json_obj_begin(w, "energy");
+    json_uint(w, "samples", energy->samples);
+    json_double(w, "mean_power_w", energy->mean_power);
+    json_double(w, "min_power_w", energy->min_power);
+    json_double(w, "max_power_w", energy->max_power);
+    json_double(w, "elapsed_seconds", energy->elapsed_secs);
+    json_double(w, "energy_j", energy->energy);
+    json_double(w, "joules_per_1000_iterations", energy->joules_per_kiloiteration);
+    json_double(w, "iterations_per_watt", energy->iterations_per_watt);
+    json_obj_end(w);
+}
+
 // Add new endpoint to get benchmark results
 esp_err_t benchmark_results_handler(httpd_req_t *req) {
     if (benchmark_mutex == NULL) {
@@ -63,23 +487,211 @@ esp_err_t benchmark_results_handler(httpd_req_t *req) {
     benchmark_result_t current_state = benchmark_state;
     xSemaphoreGive(benchmark_mutex);
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddBoolToObject(root, "running", current_state.is_running);
-    
-    if (!current_state.is_running && current_state.total_time > 0) {
-        cJSON_AddNumberToObject(root, "iterations_per_sec", current_state.iterations_per_sec);
-        cJSON_AddNumberToObject(root, "total_time_seconds", current_state.total_time);
-        cJSON_AddNumberToObject(root, "error_count", current_state.error_count);
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
+    json_obj_begin(w, NULL);
+    json_bool(w, "running", current_state.is_running);
+    json_str(w, "mode", benchmark_mode_names[current_state.mode]);
+    if (!current_state.is_running && current_state.has_result) {
+        if (current_state.mode == BENCHMARK_MODE_SWEEP) {
+            add_sweep_result(w, current_state.sweep, current_state.sweep_count);
+        } else {
+            add_benchmark_result(w, &current_state.result);
+        }
+        if (current_state.mode == BENCHMARK_MODE_INTERFERENCE) {
+            add_interference_result(w, &current_state.baseline, &current_state.result, &current_state.load);
+        }
+        if (current_state.mode == BENCHMARK_MODE_ENERGY) {
+            add_energy_result(w, &current_state.energy);
+        }
     }
+    json_obj_end(w);
+    return json_response_end(&resp);
+}
 
-    char *json_str = cJSON_Print(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Connection", "close");
-    esp_err_t err = httpd_resp_send(req, json_str, strlen(json_str));
-    
-    cJSON_Delete(root);
-    cJSON_free(json_str);
-    return err;
+// Longest query string looked at, /benchmark takes a mode, a profile and its overrides
+#define QUERY_MAX_LEN 160
+
+// Read a query parameter into value, returns false if absent or too long
+static bool query_get_str(httpd_req_t *req, const char *key, char *value, size_t len) {
+    char query[QUERY_MAX_LEN];
+
+    return httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+           httpd_query_key_value(query, key, value, len) == ESP_OK;
+}
+
+// Read an unsigned query parameter, returns def if absent or malformed
+static uint32_t query_get_uint(httpd_req_t *req, const char *key, uint32_t def) {
+    char value[12];
+    char *end;
+
+    if (!query_get_str(req, key, value, sizeof(value))) {
+        return def;
+    }
+    unsigned long parsed = strtoul(value, &end, 10);
+    return (end != value && *end == '\0') ? (uint32_t)parsed : def;
+}
+
+// Read an unsigned query parameter in base (0 also takes 0x prefixed hex). Returns 1 when
+// read, 0 when absent and -1 when malformed or above max.
+static int query_get_number(httpd_req_t *req, const char *key, int base, uint32_t max, uint32_t *value) {
+    char str[12];
+    char *end;
+
+    if (!query_get_str(req, key, str, sizeof(str))) {
+        return 0;
+    }
+    unsigned long parsed = strtoul(str, &end, base);
+    if (end == str || *end != '\0' || parsed > max) {
+        return -1;
+    }
+    *value = (uint32_t)parsed;
+    return 1;
+}
+
+// Data size, seeds and algorithms of a run: ?profile=<name> (the build parameters by
+// default) then the ?size=, ?seed1= to ?seed3= and ?algorithms=<ID_* mask> overrides.
+// custom is set when any is given. Returns NULL, or why the request is bad.
+static const char *benchmark_params_from_query(httpd_req_t *req, coremark_params_t *params, bool *custom) {
+    static const char *seed_keys[] = { "seed1", "seed2", "seed3" };
+    ee_s16 *seeds[] = { &params->seed1, &params->seed2, &params->seed3 };
+    char profile[16];
+    uint32_t value;
+    int found;
+
+    *custom = false;
+    coremark_default_params(params);
+    if (query_get_str(req, "profile", profile, sizeof(profile))) {
+        if (coremark_find_profile(profile, params) < 0) {
+            return "Unknown profile";
+        }
+        *custom = true;
+    }
+    if ((found = query_get_number(req, "size", 10, MAX_DATA_SIZE, &value)) < 0) {
+        return "Bad size";
+    } else if (found) {
+        params->size = value;
+        *custom = true;
+    }
+    for (int i = 0; i < 3; i++) {
+        if ((found = query_get_number(req, seed_keys[i], 0, 0xffff, &value)) < 0) {
+            return "Seeds must be 16 bit values";
+        } else if (found) {
+            *seeds[i] = (ee_s16)value;
+            *custom = true;
+        }
+    }
+    if ((found = query_get_number(req, "algorithms", 0, ALL_ALGORITHMS_MASK, &value)) < 0) {
+        return "Bad algorithms mask";
+    } else if (found) {
+        params->execs = value;
+        *custom = true;
+    }
+    return coremark_params_error(params);
+}
+
+// Read a comma separated list of unsigned query values. Returns the number read, 0 when
+// the parameter is absent and -1 when it is malformed or has more than max values.
+static int query_get_uint_list(httpd_req_t *req, const char *key, uint32_t *values, int max) {
+    char list[48];
+    char *p = list;
+    int count = 0;
+
+    if (!query_get_str(req, key, list, sizeof(list))) {
+        return 0;
+    }
+    while (*p != '\0') {
+        char *end;
+        unsigned long parsed = strtoul(p, &end, 10);
+        if (end == p || (*end != ',' && *end != '\0') || count == max) {
+            return -1;
+        }
+        values[count++] = (uint32_t)parsed;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+// Returns the chunks completed after ?since=<seq> right away, clients poll again for more.
+// Never waits for new chunks: the handler runs on the only server task, which would hold
+// every other request (and the load of ?mode=interference) meanwhile.
+esp_err_t benchmark_progress_handler(httpd_req_t *req) {
+    static progress_entry_t entries[PROGRESS_RING_SIZE];    // Only used from the server task
+    int count = 0;
+
+    if (benchmark_mutex == NULL) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+
+    uint32_t since = query_get_uint(req, "since", 0);
+    xSemaphoreTake(benchmark_mutex, portMAX_DELAY);
+    bool running = benchmark_state.is_running;
+    uint32_t last_seq = progress_seq;
+    if (since > last_seq) {
+        // Sequence from a previous run
+        since = 0;
+    }
+    uint32_t first = (last_seq > PROGRESS_RING_SIZE) ? last_seq - PROGRESS_RING_SIZE + 1 : 1;
+    if (since + 1 > first) {
+        first = since + 1;
+    }
+    for (uint32_t seq = first; seq <= last_seq; seq++) {
+        entries[count++] = progress_ring[seq % PROGRESS_RING_SIZE];
+    }
+    xSemaphoreGive(benchmark_mutex);
+
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
+    json_obj_begin(w, NULL);
+    json_bool(w, "running", running);
+    json_uint(w, "seq", last_seq);
+    json_uint(w, "dropped", (first > since + 1) ? first - since - 1 : 0);
+    json_arr_begin(w, "chunks");
+    for (int i = 0; i < count; i++) {
+        const coremark_progress_t *p = &entries[i].progress;
+        json_obj_begin(w, NULL);
+        json_uint(w, "seq", entries[i].seq);
+        json_uint(w, "context", p->context);
+        json_uint(w, "iterations", p->iterations);
+        json_uint(w, "done", p->done);
+        json_uint(w, "total", p->total);
+        json_int(w, "ticks", p->ticks);
+        json_int(w, "elapsed_ticks", p->elapsed);
+        json_double(w, "iterations_per_sec", p->iterations_per_sec);
+        json_obj_end(w);
+    }
+    json_arr_end(w);
+    json_obj_end(w);
+    return json_response_end(&resp);
+}
+
+// Returns the last BENCHMARK_HISTORY_SIZE runs, oldest first
+esp_err_t benchmark_history_handler(httpd_req_t *req) {
+    static benchmark_record_t records[BENCHMARK_HISTORY_SIZE];
+    int count = benchmark_history_get(records, BENCHMARK_HISTORY_SIZE);
+
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
+    json_obj_begin(w, NULL);
+    json_uint(w, "capacity", BENCHMARK_HISTORY_SIZE);
+    json_arr_begin(w, "runs");
+    for (int i = 0; i < count; i++) {
+        json_obj_begin(w, NULL);
+        json_int(w, "timestamp", records[i].timestamp);
+        json_uint(w, "boot", records[i].boot_count);
+        json_double(w, "iterations_per_sec", records[i].iterations_per_sec);
+        json_uint(w, "iterations", records[i].iterations);
+        json_bool(w, "valid", records[i].valid);
+        json_uint(w, "cpu_freq_mhz", records[i].cpu_freq_mhz);
+        json_uint(w, "free_heap", records[i].free_heap);
+        json_uint(w, "plug_state", records[i].plug_state);
+        json_str(w, "firmware", records[i].firmware);
+        json_obj_end(w);
+    }
+    json_arr_end(w);
+    json_obj_end(w);
+    return json_response_end(&resp);
 }
 
 esp_err_t benchmark_handler(httpd_req_t *req) {
@@ -87,139 +699,363 @@ esp_err_t benchmark_handler(httpd_req_t *req) {
         benchmark_mutex = xSemaphoreCreateMutex();
     }
 
+    // ?mode=interference runs under HTTP load at ?rate=<requests per second>,
+    // ?mode=sweep once per clock of ?freqs=<MHz,...> (all supported clocks by default),
+    // ?mode=energy samples the power during the run
+    char mode_str[16];
+    benchmark_mode_t mode = BENCHMARK_MODE_NORMAL;
+    if (query_get_str(req, "mode", mode_str, sizeof(mode_str))) {
+        if (strcmp(mode_str, "interference") == 0) {
+            mode = BENCHMARK_MODE_INTERFERENCE;
+        } else if (strcmp(mode_str, "sweep") == 0) {
+            mode = BENCHMARK_MODE_SWEEP;
+        } else if (strcmp(mode_str, "energy") == 0) {
+            mode = BENCHMARK_MODE_ENERGY;
+        } else if (strcmp(mode_str, "normal") != 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Unknown mode");
+            return ESP_FAIL;
+        }
+    }
+    coremark_params_t params;
+    bool custom_params;
+    const char *params_error = benchmark_params_from_query(req, &params, &custom_params);
+    if (params_error != NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, params_error);
+        return ESP_FAIL;
+    }
+    ee_s16 known_id = coremark_params_known_id(&params);
+    uint32_t rate = INTERFERENCE_DEFAULT_RATE;
+    if (mode == BENCHMARK_MODE_INTERFERENCE &&
+        (query_get_number(req, "rate", 10, LOAD_GENERATOR_MAX_RATE, &rate) < 0 || rate < LOAD_GENERATOR_MIN_RATE)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "rate must be 1 to 50 requests per second");
+        return ESP_FAIL;
+    }
+    uint32_t sweep_freqs[BENCHMARK_SWEEP_MAX_POINTS];
+    int sweep_count = 0;
+    if (mode == BENCHMARK_MODE_SWEEP) {
+        sweep_count = query_get_uint_list(req, "freqs", sweep_freqs, BENCHMARK_SWEEP_MAX_POINTS);
+        if (sweep_count < 0) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "freqs must list up to 4 clocks in MHz");
+            return ESP_FAIL;
+        }
+        if (sweep_count == 0) {
+            sweep_count = benchmark_sweep_default_freqs(sweep_freqs, BENCHMARK_SWEEP_MAX_POINTS);
+        }
+    }
+
     xSemaphoreTake(benchmark_mutex, portMAX_DELAY);
     bool already_running = benchmark_state.is_running;
     
+    // Reserves the data block, the previous run is done with it
+    if (!already_running && coremark_set_params(custom_params ? &params : NULL) != 0) {
+        xSemaphoreGive(benchmark_mutex);
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Not enough memory for the data");
+        return ESP_FAIL;
+    }
     if (!already_running) {
         // Only start if not already running
         benchmark_state.is_running = true;
-        benchmark_state.iterations_per_sec = 0;
-        benchmark_state.total_time = 0;
-        benchmark_state.error_count = 0;
+        benchmark_state.has_result = false;
+        benchmark_state.mode = mode;
+        benchmark_state.rate = rate;
+        benchmark_state.sweep_count = sweep_count;
+        memcpy(benchmark_state.sweep_freqs, sweep_freqs, sizeof(sweep_freqs));
+        progress_seq = 0;
         xSemaphoreGive(benchmark_mutex);
         
-        // Create benchmark task with lowest priority
+        // Create benchmark task with lowest priority. On the same core as context 0, so
+        // the start and stop times come from one cycle counter with CORE_TIMER_CYCLES.
+#if (portNUM_PROCESSORS > 1)
+        xTaskCreatePinnedToCore(benchmark_task, "benchmark", 8192, NULL,
+                   tskIDLE_PRIORITY, // Lowest priority
+                   NULL, 0);
+#else
         xTaskCreate(benchmark_task, "benchmark", 8192, NULL, 
                    tskIDLE_PRIORITY, // Lowest priority
                    NULL);
+#endif
     } else {
         xSemaphoreGive(benchmark_mutex);
     }
     
     // Always return immediate response
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddBoolToObject(root, "running", true);
-    cJSON_AddStringToObject(root, "message", already_running ? 
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
+    json_obj_begin(w, NULL);
+    json_bool(w, "running", true);
+    json_str(w, "message", already_running ? 
         "Benchmark already running" : "Benchmark started");
-    
-    char *json_str = cJSON_Print(root);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Connection", "close");
-    esp_err_t err = httpd_resp_send(req, json_str, strlen(json_str));
-    
-    // Cleanup
-    cJSON_Delete(root);
-    cJSON_free(json_str);
-    
-    return err;
+    if (!already_running) {
+        // null when the run cannot be checked against the known crcs
+        json_str(w, "profile", coremark_profile_name(known_id));
+    }
+    json_obj_end(w);
+    return json_response_end(&resp);
 }
 
-SemaphoreHandle_t mutex;
 esp_timer_handle_t status_timer;
 esp_timer_handle_t state_timer;
 
-// Plug state (0 for off, 1 for on)
-static int plug_state = 0;
-// Status information
-static const char *firmware_version = "1.0.0";
+// Entries of /plug/history copied out of the history at a time
+#define HISTORY_BATCH_ENTRIES 32
 
-// Utility function to create JSON objects
-cJSON *create_json_status() {
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "firmware", firmware_version);
-    return root;
+// Output of /plug/history, buffered in response_buf and sent in chunks
+typedef struct {
+    httpd_req_t *req;
+    size_t len;
+    bool binary;
+    bool started;               // Binary header written
+    uint32_t resolution;
+    esp_err_t err;
+} history_stream_t;
+
+static bool history_stream_put(history_stream_t *stream, const void *data, size_t len) {
+    if (stream->len + len > sizeof(response_buf)) {
+        stream->err = httpd_resp_send_chunk(stream->req, response_buf, stream->len);
+        stream->len = 0;
+    }
+    memcpy(response_buf + stream->len, data, len);
+    stream->len += len;
+    return stream->err == ESP_OK;
+}
+
+// Byte by byte so the layout does not depend on the host byte order
+static void put_le(uint8_t *buf, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        buf[i] = (uint8_t)(value >> (8 * i));
+    }
 }
 
-cJSON *create_json_state() {
-cJSON *root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "state", plug_state);
-    return root;
+// Binary header: start time of the first entry and resolution, both uint32 little endian
+static bool history_stream_header(history_stream_t *stream, uint32_t time) {
+    uint8_t header[8];
+
+    put_le(header, time, 4);
+    put_le(header + 4, stream->resolution, 4);
+    stream->started = true;
+    return history_stream_put(stream, header, sizeof(header));
 }
 
+static bool history_stream_entry(history_stream_t *stream, uint32_t time, const power_history_entry_t *entry) {
+    char line[48];
+    int len;
+
+    if (stream->binary) {
+        // Entries follow each other without gaps: min, max and mean, uint16 little endian in 0.1 W
+        uint8_t buf[6];
+
+        if (!stream->started && !history_stream_header(stream, time)) {
+            return false;
+        }
+        put_le(buf, entry->min, 2);
+        put_le(buf + 2, entry->max, 2);
+        put_le(buf + 4, entry->mean, 2);
+        return history_stream_put(stream, buf, sizeof(buf));
+    }
+    if (entry->mean == POWER_HISTORY_NO_DATA) {
+        len = snprintf(line, sizeof(line), "%u,,,\n", (unsigned)time);
+    } else {
+        len = snprintf(line, sizeof(line), "%u,%u.%u,%u.%u,%u.%u\n", (unsigned)time,
+                       entry->min / 10, entry->min % 10, entry->max / 10, entry->max % 10,
+                       entry->mean / 10, entry->mean % 10);
+    }
+    return history_stream_put(stream, line, len);
+}
+
+// Power history, ?from=<seconds since boot>&res=<1|60|900>&format=<csv|binary>.
+// Without format, an Accept header listing application/octet-stream selects binary.
+esp_err_t power_history_handler(httpd_req_t *req) {
+    static char uptime[12];     // Header values must outlive the handler's sends
+    char format[8];
+    uint32_t from = query_get_uint(req, "from", 0);
+    history_stream_t stream = { .req = req, .err = ESP_OK };
+
+    if (query_get_str(req, "format", format, sizeof(format))) {
+        stream.binary = strcmp(format, "binary") == 0;
+    } else {
+        stream.binary = request_accepts_binary(req);
+    }
+    stream.resolution = query_get_uint(req, "res", power_history_resolution(from));
+
+    http_session_touch(req);
+    httpd_resp_set_type(req, stream.binary ? BINARY_CONTENT_TYPE : "text/csv");
+    httpd_resp_set_hdr(req, "Vary", "Accept");
+    snprintf(uptime, sizeof(uptime), "%u", (unsigned)(esp_timer_get_time() / 1000000));
+    httpd_resp_set_hdr(req, "X-Uptime", uptime);
+    if (!stream.binary) {
+        history_stream_put(&stream, "time,min,max,mean\n", strlen("time,min,max,mean\n"));
+    }
+
+    // Entries are copied out in batches and sent without holding the history, so the
+    // sampler is not locked out while a slow client is served
+    uint32_t cursor = from;
+    size_t count;
+    do {
+        power_history_entry_t entries[HISTORY_BATCH_ENTRIES];
+        uint32_t expected = cursor;
+        uint32_t time;
+
+        count = HISTORY_BATCH_ENTRIES;
+        esp_err_t err = power_history_read(stream.resolution, &cursor, entries, &count, &time);
+        if (err == ESP_ERR_NOT_FOUND) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "res must be 1, 60 or 900");
+            return ESP_FAIL;
+        }
+        // Entries overwritten since the previous batch would leave a gap in a binary reply
+        if (err != ESP_OK || (stream.binary && stream.started && count > 0 && time != expected)) {
+            break;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (!history_stream_entry(&stream, time + i * stream.resolution, &entries[i])) {
+                count = 0;
+                break;
+            }
+        }
+    } while (count == HISTORY_BATCH_ENTRIES);
+    if (stream.binary && !stream.started) {
+        history_stream_header(&stream, from);
+    }
+    if (stream.err == ESP_OK && stream.len > 0) {
+        stream.err = httpd_resp_send_chunk(req, response_buf, stream.len);
+    }
+    if (stream.err == ESP_OK) {
+        stream.err = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return stream.err;
+}
 
 // Status handler
 esp_err_t status_get_handler(httpd_req_t *req) {
-cJSON *status_json = create_json_status();
-    char *json_str = cJSON_Print(status_json);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Connection", "close");
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_send(req, json_str, strlen(json_str));
-cJSON_Delete(status_json);
-    cJSON_free(json_str);
-return ESP_OK;
+    json_obj_begin(w, NULL);
+    json_str(w, "firmware", firmware_version);
+    json_obj_begin(w, "connections");
+    json_uint(w, "opened", session_stats.connections);
+    json_uint(w, "requests", session_stats.requests);
+    json_uint(w, "reused", session_stats.reused);
+    json_uint(w, "idle_closed", session_stats.idle_closed);
+    json_obj_end(w);
+    json_obj_end(w);
+    json_response_end(&resp);
+    return ESP_OK;
 }
 
-// State GET handler
-esp_err_t state_get_handler(httpd_req_t *req) {
-    cJSON *state_json = create_json_state();
-    char *json_str = cJSON_Print(state_json);
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Connection", "close");
-    esp_err_t err = httpd_resp_send(req, json_str, strlen(json_str));
-    cJSON_Delete(state_json);
-    cJSON_free(json_str);
-    return err;
+// Read the whole request body into buf, replying with an error when it is too large
+// or the connection times out. Returns the body length, or -1 once a reply was sent.
+static int read_request_body(httpd_req_t *req, char *buf, size_t size) {
+    if (req->content_len > size) {
+        httpd_resp_set_status(req, "413 Payload Too Large");
+        httpd_resp_set_hdr(req, "Connection", "close");
+        httpd_resp_sendstr(req, "Request body too large");
+        return -1;
+    }
+
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                httpd_resp_send_408(req);
+            }
+            return -1;
+        }
+        received += ret;
+    }
+    return received;
 }
 
+// Request body buffer shared by the device actions, like response_buf
+static char request_buf[JSON_READER_MAX_BODY];
 
-// State PUT handler
-esp_err_t state_put_handler(httpd_req_t *req) {
-    char buf[100];
-    int ret;
+// Device endpoints are found by a perfect hash instead of one registered handler each
+static route_table_t device_routes;
 
-    /* Read request content */
-    ret = httpd_req_recv(req, buf, sizeof(buf));
-    if (ret <= 0) {
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
-            httpd_resp_send_408(req);
-        }
+#define DEVICE_ACTION_METHODS 4
+static const httpd_method_t action_http_methods[DEVICE_ACTION_METHODS] = {
+    [ACTION_GET] = HTTP_GET,
+    [ACTION_PUT] = HTTP_PUT,
+    [ACTION_POST] = HTTP_POST,
+    [ACTION_DELETE] = HTTP_DELETE,
+};
+
+// Serves /<device_type>/* for the action_method_t passed as user_ctx
+static esp_err_t device_action_handler(httpd_req_t *req) {
+    action_method_t method = (action_method_t)(intptr_t)req->user_ctx;
+    const char *uri = req->uri + 1 + strlen(DEVICE_CONFIG.device_type);
+    const char *query = strchr(uri, '?');
+    size_t len = query != NULL ? (size_t)(query - uri) : strlen(uri);
+    action_request_t request = { .body = NULL, .body_len = 0, .format = ACTION_FORMAT_JSON };
+
+    const device_endpoint_t *endpoint = route_table_lookup(&device_routes, method, uri, len);
+    if (endpoint == NULL) {
+        httpd_resp_send_404(req);
         return ESP_FAIL;
     }
 
-    cJSON *root = cJSON_Parse(buf);
-    if (root == NULL) {
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    if (req->content_len > 0) {
+        int body_len = read_request_body(req, request_buf, sizeof(request_buf));
+        if (body_len < 0) {
+            return ESP_FAIL;
+        }
+        request.body = request_buf;
+        request.body_len = body_len;
     }
 
-    cJSON *state_item = cJSON_GetObjectItem(root, "state");
-    if (state_item == NULL || !cJSON_IsNumber(state_item)) {
-        cJSON_Delete(root);
-        httpd_resp_send_500(req);
-        return ESP_FAIL;
+    json_response_t resp;
+    json_writer_t *w = json_response_begin(&resp, req);
+    if (endpoint->binary) {
+        httpd_resp_set_hdr(req, "Vary", "Accept");
+        if (request_accepts_binary(req)) {
+            request.format = ACTION_FORMAT_BINARY;
+            httpd_resp_set_type(req, BINARY_CONTENT_TYPE);
+        }
     }
-        // Protect the plug state shared variable with mutex
-        xSemaphoreTake(mutex, portMAX_DELAY);
-        plug_state = state_item->valueint;
-        xSemaphoreGive(mutex);
-        
-        // Create response
-        cJSON *response = cJSON_CreateObject();
-        cJSON_AddNumberToObject(response, "state", plug_state);
-        char *json_str = cJSON_Print(response);
-        
-        // Send response
+    esp_err_t err = endpoint->handler(&request, w);
+    if (err != ESP_OK && !resp.chunked) {
+        // Replace whatever the action wrote with an Error object
+        httpd_resp_set_status(req, err == ESP_ERR_INVALID_ARG ? "400 Bad Request" : "500 Internal Server Error");
         httpd_resp_set_type(req, "application/json");
-        httpd_resp_set_hdr(req, "Connection", "close");
-        esp_err_t err = httpd_resp_send(req, json_str, strlen(json_str));
-        
-        // Cleanup
-        cJSON_Delete(root);
-        cJSON_Delete(response);
-        cJSON_free(json_str);
-        
-        return err;
+        json_writer_init(w, response_buf, sizeof(response_buf), json_response_flush, &resp);
+        json_obj_begin(w, NULL);
+        json_str(w, "message", err == ESP_ERR_INVALID_ARG ? "Invalid request" : esp_err_to_name(err));
+        json_obj_end(w);
+    }
+    return json_response_end(&resp);
+}
+
+#define DEVICE_URI_MAX 32
+
+// Route /<device_type>/* to the endpoints of DEVICE_CONFIG, with one wildcard handler per
+// method in use. Registered after the fixed handlers so those take precedence.
+static void register_device_endpoints(httpd_handle_t server) {
+    char uri[DEVICE_URI_MAX];
+
+    esp_err_t err = route_table_build(&device_routes, DEVICE_CONFIG.endpoints, DEVICE_CONFIG.num_endpoints);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to build the %s routes: %s", DEVICE_CONFIG.device_type, esp_err_to_name(err));
+        return;
+    }
+    snprintf(uri, sizeof(uri), "/%s/*", DEVICE_CONFIG.device_type);
+    for (int method = 0; method < DEVICE_ACTION_METHODS; method++) {
+        bool used = false;
+        for (int i = 0; i < DEVICE_CONFIG.num_endpoints; i++) {
+            used |= DEVICE_CONFIG.endpoints[i].method == (action_method_t)method;
+        }
+        if (!used) {
+            continue;
+        }
+        httpd_uri_t handler = {
+            .uri = uri,                 // Copied by the server
+            .method = action_http_methods[method],
+            .handler = device_action_handler,
+            .user_ctx = (void *)(intptr_t)method
+        };
+        if (httpd_register_uri_handler(server, &handler) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register %s", uri);
+        }
+    }
 }
 
 // Handler for root URL
@@ -238,12 +1074,12 @@ esp_err_t root_handler(httpd_req_t *req) {
         "    <p>Current plug state: %s</p>\n"
         "</body>\n"
         "</html>",
-        plug_state ? "ON" : "OFF"
+        get_plug_state() ? "ON" : "OFF"
     );
     
+    http_session_touch(req);
     httpd_resp_set_type(req, "text/html; charset=UTF-8");
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache, no-store, must-revalidate");
-    httpd_resp_set_hdr(req, "Connection", "close");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_send(req, html, strlen(html));
     return ESP_OK;
@@ -263,36 +1099,59 @@ httpd_uri_t status_uri = {
     .handler = status_get_handler,
     .user_ctx = NULL};
 
-httpd_uri_t state_get_uri = {
-    .uri = "/plug/state",
-    .method = HTTP_GET,
-    .handler = state_get_handler,
-    .user_ctx = NULL};
-
-httpd_uri_t state_put_uri = {
-    .uri = "/plug/state",
-    .method = HTTP_PUT,
-    .handler = state_put_handler,
-    .user_ctx = NULL};
-
+// Handlers registered by start_webserver besides the device endpoints
+#define SERVER_URI_HANDLERS 7
 
 // Helper function to start the server
 httpd_handle_t start_webserver() {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.server_port = 80;
+    config.server_port = WEB_SERVER_PORT;
     config.lru_purge_enable = true;      // Enable LRU purge
-    config.max_uri_handlers = 8;         // Increase max handlers
-    config.max_open_sockets = 3;         // Allow multiple concurrent connections
+    config.max_uri_handlers = SERVER_URI_HANDLERS + DEVICE_ACTION_METHODS;
+    config.uri_match_fn = httpd_uri_match_wildcard; // For the device routes
+    config.max_open_sockets = HTTP_MAX_SESSIONS; // Keep-alive sessions, 3 of the 10 lwIP sockets stay free
     config.task_priority = 5;            // Higher priority for server task
     config.stack_size = 4096;            // Increased stack size
 
+    if (DEVICE_CONFIG.init != NULL && DEVICE_CONFIG.init() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to initialize %s", DEVICE_CONFIG.device_type);
+    }
+    if (benchmark_history_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Benchmark history will not be persisted");
+    }
+
+    for (int i = 0; i < HTTP_MAX_SESSIONS; i++) {
+        sessions[i].fd = -1;
+    }
+    memset(&session_stats, 0, sizeof(session_stats));
+
     httpd_handle_t server = NULL;
     if (httpd_start(&server, &config) == ESP_OK) {
-    ESP_LOGI(TAG, "Webserver started on port 80");
+    ESP_LOGI(TAG, "Webserver started on port %d", WEB_SERVER_PORT);
+        session_server = server;
+        if (session_sweep_timer == NULL) {
+            const esp_timer_create_args_t sweep_args = {
+                .callback = http_session_sweep_timer_callback,
+                .name = "http_sweep",
+            };
+            if (esp_timer_create(&sweep_args, &session_sweep_timer) != ESP_OK) {
+                ESP_LOGW(TAG, "Idle connections will only be closed by LRU purge");
+            }
+        }
+        if (session_sweep_timer != NULL) {
+            esp_timer_start_periodic(session_sweep_timer, KEEPALIVE_SWEEP_MS * 1000);
+        }
         httpd_register_uri_handler(server, &root_uri);
         httpd_register_uri_handler(server, &status_uri);
-        httpd_register_uri_handler(server, &state_get_uri);
-        httpd_register_uri_handler(server, &state_put_uri);
+
+        httpd_uri_t power_history_uri = {
+            .uri = "/plug/history",
+            .method = HTTP_GET,
+            .handler = power_history_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &power_history_uri);
+        register_device_endpoints(server);
     
         httpd_uri_t benchmark_uri = {
             .uri = "/benchmark",
@@ -309,6 +1168,22 @@ httpd_handle_t start_webserver() {
             .user_ctx = NULL
         };
         httpd_register_uri_handler(server, &benchmark_results_uri);
+
+        httpd_uri_t benchmark_progress_uri = {
+            .uri = "/benchmark/progress",
+            .method = HTTP_GET,
+            .handler = benchmark_progress_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &benchmark_progress_uri);
+
+        httpd_uri_t benchmark_history_uri = {
+            .uri = "/benchmark/history",
+            .method = HTTP_GET,
+            .handler = benchmark_history_handler,
+            .user_ctx = NULL
+        };
+        httpd_register_uri_handler(server, &benchmark_history_uri);
         return server;
     }
     ESP_LOGE(TAG, "Failed to start webserver");
@@ -317,7 +1192,14 @@ return NULL;
 
 void stop_webserver(httpd_handle_t server) {
     if (server) {
+        if (session_sweep_timer != NULL) {
+            esp_timer_stop(session_sweep_timer);
+        }
+        session_server = NULL;
         httpd_stop(server);
+        if (DEVICE_CONFIG.deinit != NULL) {
+            DEVICE_CONFIG.deinit();
+        }
         ESP_LOGI(TAG, "Webserver stopped");
     }
 }
@@ -339,12 +1221,8 @@ esp_http_client_handle_t client = esp_http_client_init(&config);
 
 // Simulate state change with a timer
 void state_change_timer_callback(void *args) {
-// Protect the plug state shared variable with mutex
-    xSemaphoreTake(mutex, portMAX_DELAY);
-    plug_state = (plug_state + 1) % 2;
-    xSemaphoreGive(mutex);
     char json_payload[30];
-    sprintf(json_payload, "{\"state\": %d}", plug_state);
+    sprintf(json_payload, "{\"state\": %d}", (get_plug_state() + 1) % 2);
     esp_http_client_config_t config = {
         .url = "http://192.168.1.100/plug/state",
         .method = HTTP_METHOD_PUT,
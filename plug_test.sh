@@ -40,5 +40,20 @@ done
 
 echo -e "\nToggle test complete"
 
+echo "Batch toggle:"
+curl -s -X POST -H "Content-Type: application/json" \
+     -d '[{"state": 1}, {"output": 0, "state": 0}]' \
+     "http://$IP_ADDRESS/plug/batch"
+echo
+
+echo "Polling state 50 times over one keep-alive connection (seconds per request):"
+curl -s -o /dev/null -w "%{time_total}\n" "http://$IP_ADDRESS/plug/state?poll=[1-50]" | sort -n | \
+    awk '{t[NR]=$1} END {print "p50", t[int(NR*0.5)], "p99", t[int(NR*0.99)], "max", t[NR]}'
+curl -s "http://$IP_ADDRESS/plug/status"
+echo
+
 echo "Starting basline benchmark"
 curl -X GET "http://$IP_ADDRESS/benchmark"
+
+echo -e "\nStarting interference benchmark (results in /benchmark/results when done)"
+curl -X GET "http://$IP_ADDRESS/benchmark?mode=interference&rate=10"